@@ -0,0 +1,78 @@
+function T = read_trace(path)
+%READ_TRACE Load a c-cnc binary trace (see src/trace.h) as a table
+%   T = read_trace('c-cnc.trc') returns a table with the same columns as
+%   the CSV output of c-cnc (n, t_tot, t_blk, lambda, s, feed, x, y, z),
+%   or the subset of them selected in the [TRACE] section of settings.ini.
+%   Chunks are read in sequence, so files without the final index (e.g.
+%   after a crash) are loaded as well, up to the last complete chunk.
+
+  fid = fopen(path, 'r', 'ieee-le');
+  if fid < 0
+    error('read_trace:open', 'Cannot open %s', path);
+  end
+  cleanup = onCleanup(@() fclose(fid));
+
+  %% Header
+  magic = fread(fid, [1 8], '*char');
+  if ~strcmp(magic, 'CCNCTRC1')
+    error('read_trace:format', '%s is not a C-CNC trace', path);
+  end
+  ncols = fread(fid, 1, 'uint32');
+  fread(fid, 1, 'uint32'); % chunk rows
+  names = cell(1, ncols);
+  scale = zeros(1, ncols);
+  order = zeros(1, ncols);
+  stored = true(1, ncols);
+  for c = 1:ncols
+    name = fread(fid, [1 16], '*char');
+    names{c} = strtok(name, char(0));
+    scale(c) = fread(fid, 1, 'double');
+    order(c) = fread(fid, 1, 'uint32');
+    stored(c) = fread(fid, 1, 'uint32') == 0;
+  end
+
+  %% Chunks
+  data = {};
+  while true
+    head = fread(fid, 2, 'uint32');
+    if numel(head) < 2 || head(1) ~= hex2dec('4b4e4843') % 'CHNK'
+      break % index, or end of a truncated file
+    end
+    rows = head(2);
+    bytes = fread(fid, ncols, 'uint32');
+    if numel(bytes) < ncols
+      break
+    end
+    chunk = zeros(rows, ncols);
+    for c = find(stored)
+      payload = fread(fid, bytes(c), '*uint8');
+      if numel(payload) < bytes(c)
+        chunk = [];
+        break
+      end
+      v = unvarint(payload);
+      for k = 1:order(c)
+        v = cumsum(v);
+      end
+      chunk(:, c) = v / scale(c);
+    end
+    if isempty(chunk)
+      break
+    end
+    data{end+1} = chunk; %#ok<AGROW>
+  end
+  data = vertcat(data{:});
+  T = array2table(data(:, stored), 'VariableNames', names(stored));
+end
+
+function v = unvarint(b)
+%UNVARINT Decode a vector of zig-zag varints, without loops
+  last = find(b < 128);
+  first = [1; last(1:end-1) + 1];
+  len = last - first + 1;
+  shift = (1:numel(b))' - repelem(first, len);
+  z = accumarray(repelem((1:numel(last))', len), ...
+    double(bitand(b, 127)) .* 2.^(7 * shift));
+  odd = mod(z, 2);
+  v = (z + odd) / 2 .* (1 - 2 * odd);
+end
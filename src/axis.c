@@ -0,0 +1,110 @@
+//      _          _
+//     / \   __  _(_)___
+//    / _ \  \ \/ / / __|
+//   / ___ \  >  <| \__ \
+//  /_/   \_\/_/\_\_|___/
+
+#include "axis.h"
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// Axis object structure
+typedef struct axis {
+  data_t omega_n, zeta;  // closed loop dynamics
+  data_t a_max, v_max;   // saturations (torque and speed limits)
+  data_t x, v;           // state: position and velocity
+} axis_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+axis_t *axis_new(data_t omega_n, data_t zeta, data_t a_max, data_t v_max) {
+  assert(omega_n > 0 && zeta > 0 && a_max > 0 && v_max > 0);
+  axis_t *a = (axis_t *)calloc(1, sizeof(axis_t));
+  if (!a) {
+    perror("Error creating axis");
+    exit(EXIT_FAILURE);
+  }
+  a->omega_n = omega_n;
+  a->zeta = zeta;
+  a->a_max = a_max;
+  a->v_max = v_max;
+  return a;
+}
+
+void axis_free(axis_t *a) {
+  assert(a);
+  free(a);
+  a = NULL;
+}
+
+void axis_reset(axis_t *a, data_t x) {
+  assert(a);
+  a->x = x;
+  a->v = 0;
+}
+
+
+// SIMULATION ==================================================================
+
+void axis_step(axis_t *a, data_t setpoint, data_t dt) {
+  assert(a);
+  data_t acc = a->omega_n * a->omega_n * (setpoint - a->x) -
+               2 * a->zeta * a->omega_n * a->v;
+  // the motor cannot deliver more than its peak torque...
+  if (acc > a->a_max) acc = a->a_max;
+  else if (acc < -a->a_max) acc = -a->a_max;
+  // ...nor spin faster than its max speed (semi-implicit Euler)
+  a->v += acc * dt;
+  if (a->v > a->v_max) a->v = a->v_max;
+  else if (a->v < -a->v_max) a->v = -a->v_max;
+  a->x += a->v * dt;
+}
+
+
+// GETTERS =====================================================================
+
+data_t axis_position(const axis_t *a) {
+  assert(a);
+  return a->x;
+}
+
+data_t axis_velocity(const axis_t *a) {
+  assert(a);
+  return a->v;
+}
+
+
+
+
+//   _____ _____ ____ _____   __  __       _
+//  |_   _| ____/ ___|_   _| |  \/  | __ _(_)_ __
+//    | | |  _| \___ \ | |   | |\/| |/ _` | | '_ \
+//    | | | |___ ___) || |   | |  | | (_| | | | | |
+//    |_| |_____|____/ |_|   |_|  |_|\__,_|_|_| |_|
+// Only needed for testing purpose. To enable, compile as:
+// clang src/axis.c -o axis -lm -DAXIS_MAIN
+// Prints the response to a 100 mm step as CSV
+#ifdef AXIS_MAIN
+int main() {
+  axis_t *a = axis_new(30, 0.8, 5000, 200);
+  data_t t, dt = 0.0005;
+  printf("t,x,v\n");
+  for (t = 0; t < 1.5; t += dt) {
+    axis_step(a, 100, dt);
+    printf("%f,%f,%f\n", t + dt, axis_position(a), axis_velocity(a));
+  }
+  axis_free(a);
+  return 0;
+}
+#endif
@@ -0,0 +1,54 @@
+//      _          _
+//     / \   __  _(_)___
+//    / _ \  \ \/ / / __|
+//   / ___ \  >  <| \__ \
+//  /_/   \_\/_/\_\_|___/
+//  Axis class
+//  Position-controlled machine axis, modelled as in MATLAB/SimpleAxis: a
+//  DC motor driving a lead screw under PID control. The closed loop is a
+//  second order system (natural frequency omega_n, damping zeta) whose
+//  acceleration and speed saturate at the motor torque and speed limits.
+
+#ifndef AXIS_H
+#define AXIS_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct axis axis_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// omega_n in rad/s, zeta adimensional, a_max in mm/s^2, v_max in mm/s
+axis_t *axis_new(data_t omega_n, data_t zeta, data_t a_max, data_t v_max);
+void axis_free(axis_t *a);
+
+// Place the axis at rest in x
+void axis_reset(axis_t *a, data_t x);
+
+// SIMULATION ==================================================================
+
+// Advance the axis by dt seconds towards setpoint (explicit integration:
+// keep dt well below 1/omega_n)
+void axis_step(axis_t *a, data_t setpoint, data_t dt);
+
+// GETTERS =====================================================================
+
+data_t axis_position(const axis_t *a);
+data_t axis_velocity(const axis_t *a);
+
+#endif // AXIS_H
@@ -13,12 +13,21 @@
 //  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
 //  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
 
-// Trapezoidal velocity profile
+// Along arcs, share of A left to the centripetal acceleration: the rest
+// goes to the tangential one, which must not vanish
+#define ARC_CENTRIPETAL 0.9
+
+// Trapezoidal velocity profile. Feed hold and override replan it from the
+// middle of the block: the profile then starts at time t_0, position s_0
+// and speed v_0, and ends at s_1 (0, 0, 0 and l when planned on the whole
+// block)
 typedef struct {
   data_t a, d;             // acceleration
   data_t f, l;             // feedrate and length
   data_t dt_1, dt_m, dt_2; // trapezoid times
-  data_t dt;               // total time
+  data_t dt;               // total time (end time, since t_0)
+  data_t t_0, s_0, s_1;    // start time, start and end positions
+  data_t v_0;              // start speed
 } block_profile_t;
 
 // Block object structure
@@ -37,6 +46,7 @@ typedef struct block {
   data_t i, j, r;        // center coordinates and radius (if it is an arc)
   data_t theta0, dtheta; // arc initial angle and arc angle
   data_t acc;            // actual acceleration
+  data_t override;       // feed override factor
   machine_t *machine;    // machine configuration
   block_profile_t *prof; // velocity profile
   struct block *prev;    // next block (linked list)
@@ -47,7 +57,12 @@ typedef struct block {
 static int block_set_fields(block_t *b, char cmd, char *arg);
 static point_t *point_zero(block_t *b);
 static void block_compute(block_t *b);
+static void block_plan(block_t *b, data_t t_0, data_t s_0);
+static int block_feed(block_t *b);
+static data_t block_acc_at(const block_t *b, data_t v);
+static data_t profile_position(const block_profile_t *p, data_t t, data_t *v);
 static int block_arc(block_t *b);
+static void block_rapid(block_t *b);
 static data_t quantize(data_t t, data_t tq, data_t *dq);
 
 //   _____                 _   _
@@ -93,6 +108,7 @@ block_t *block_new(const char *line, block_t *prev, machine_t *cfg) {
   b->machine = cfg;
   b->type = NO_MOTION;
   b->acc = machine_A(b->machine);
+  b->override = 1.0;
   b->line = strdup(line);
   if (! b->line) {
     perror("Could not allocate line");
@@ -161,10 +177,16 @@ int block_parse(block_t *b) {
   
   // deal with motion blocks
   switch (b->type) {
+  case RAPID:
+    // only interpolated rapids have a profile; null rapids take no time
+    if (machine_rapid_interp(b->machine) && b->length > 0) {
+      block_rapid(b);
+      block_compute(b);
+    }
+    break;
   case LINE:
     // calculate feed profile
-    b->acc = machine_A(b->machine);
-    b->act_feedrate = b->feedrate;
+    block_feed(b);
     block_compute(b);
     break;
   case ARC_CW:
@@ -175,16 +197,7 @@ int block_parse(block_t *b) {
       break;
     }
     // set corrected feedrate and acceleration
-    // centripetal acc = f^2/r, must be <= A
-    // INI file gives A in mm/s^2, feedrate is given in mm/min
-    b->act_feedrate =
-        MIN(b->feedrate, sqrt(machine_A(b->machine) * b->r) * 60);
-    // tangential acceleration: when composed with centripetal one, total
-    // acceleration must be <= A
-    // a^2 <= A^2 + v^4/r^2
-    b->acc = sqrt(pow(machine_A(b->machine), 2) - pow(b->act_feedrate / 60, 4) / pow(b->r, 2));
-    // deal with complex result
-    if (isnan(b->acc)) {
+    if (block_feed(b)) {
       eprintf("Cannot compute arc: insufficient acceleration");
       rv++;
     }
@@ -202,39 +215,164 @@ int block_parse(block_t *b) {
 // Evaluate the value of lambda at a certaint time
 data_t block_lambda(const block_t *b, data_t t, data_t *v) {
   assert(b);
-  data_t r;
-  data_t dt_1 = b->prof->dt_1;
-  data_t dt_2 = b->prof->dt_2;
-  data_t dt_m = b->prof->dt_m;
-  data_t a = b->prof->a;
-  data_t d = b->prof->d;
-  data_t f = b->prof->f;
+  data_t r = profile_position(b->prof, t, v);
+  r /= b->prof->l;
+  *v *= 60; // convert to mm/min
+  return r;
+}
 
-  if (t < 0) {
-    r = 0.0;
-    *v = 0.0;
+// Replan the profile into a stop at time t
+int block_hold(block_t *b, data_t t) {
+  assert(b);
+  block_profile_t *p = b->prof, plan = *b->prof;
+  data_t v, s, dq, dt_2, acc;
+  data_t tq = machine_tq(b->machine);
+  s = profile_position(p, t, &v);
+  p->t_0 = t;
+  p->s_0 = s;
+  p->dt_1 = p->dt_m = 0;
+  p->a = p->v_0 = 0;
+  p->f = v;
+  if (v <= 0) { // already at rest: the stop is immediate
+    p->dt_2 = p->d = 0;
+    p->s_1 = s;
+    p->dt = t;
+    return 0;
   }
-  else if (t < dt_1) { // acceleration
-    r = a * pow(t, 2) / 2.0;
-    *v = a * t;
+  // slow down at the block acceleration (possibly reduced along arcs),
+  // stopping on a sampling time
+  acc = block_acc_at(b, v);
+  dt_2 = acc > 0 ? quantize(v / acc, tq, &dq) : INFINITY;
+  if (s + v * dt_2 / 2.0 > p->l) {
+    // past the planned deceleration point (or within a sampling time of
+    // it): braking harder than acc to stop before the end is not allowed,
+    // and the planned profile already stops at the end, within acc
+    *p = plan;
+    return 0;
   }
-  else if (t < (dt_1 + dt_m)) { // maintenance
-    r = f * (dt_1 / 2.0 + (t - dt_1));
-    *v = f;
+  p->dt_2 = dt_2;
+  p->d = -(v / p->dt_2);
+  p->s_1 = s + v * p->dt_2 / 2.0;
+  p->dt = t + p->dt_2;
+  return 0;
+}
+
+// Replan a trapezoidal profile from rest at time t to the block end
+int block_resume(block_t *b, data_t t) {
+  assert(b);
+  block_profile_t *p = b->prof;
+  data_t s = p->s_1;
+  // the stop time is a multiple of tq only up to rounding errors
+  if (t + machine_tq(b->machine) / 2.0 < p->dt) {
+    eprintf("Cannot resume block %zu: still moving\n", b->n);
+    return 1;
   }
-  else if (t < (dt_1 + dt_m + dt_2)) { // deceleration
-    data_t t_2 = dt_1 + dt_m;
-    r = f * dt_1 / 2.0 + f * (dt_m + t - t_2) +
-      d / 2.0 * (pow(t, 2) + pow(t_2, 2)) - d * t * t_2;
-    *v = f + d * (t - dt_1 - dt_m);
+  if (p->l - s <= 0) { // held at the very end: nothing left to do
+    p->t_0 = p->dt = t;
+    p->s_0 = p->s_1 = p->l;
+    p->dt_1 = p->dt_m = p->dt_2 = 0;
+    return 0;
+  }
+  block_plan(b, t, s);
+  return 0;
+}
+
+// Replan the rest of the profile from time t, at the current feedrate
+int block_replan(block_t *b, data_t t) {
+  assert(b);
+  block_profile_t *p = b->prof;
+  data_t A, tq = machine_tq(b->machine);
+  data_t v_0, s_0, l, f, dt_1, dt_m, dt_2, dt, dq, disc;
+  if (t <= 0) { // not started yet: the original plan
+    block_plan(b, 0, 0);
+    return 0;
+  }
+  s_0 = profile_position(p, t, &v_0);
+  l = p->l - s_0;
+  if (v_0 <= 0 || l <= 0) { // at rest (or at the end): same as a resume
+    p->dt = MIN(p->dt, t);
+    p->s_1 = s_0;
+    return block_resume(b, t);
+  }
+  f = b->act_feedrate / 60.0;
+  // along arcs, braking from above the new feedrate is limited by the
+  // centripetal acceleration at the current speed
+  A = block_acc_at(b, MAX(v_0, f));
+  if (pow(v_0, 2) / (2.0 * A) >= l) {
+    // already braking into the block end: the current profile stops there
+    // within its own acceleration, which a new one could not
+    return 0;
+  }
+  // from v_0 to f, then from f to rest at the block end
+  dt_1 = fabs(f - v_0) / A;
+  dt_2 = f / A;
+  dt_m = (l - (v_0 + f) / 2.0 * dt_1 - f * dt_2 / 2.0) / f;
+  if (dt_m < 0) { // too short to reach f: accelerate to the peak and stop
+    f = sqrt(A * l + pow(v_0, 2) / 2.0);
+    dt_1 = (f - v_0) / A;
+    dt_2 = f / A;
+    dt_m = 0;
+  }
+  // end on a sampling time: the same length in the longer time dt, with
+  // the phases still at A and a lower cruise speed. Braking to f first:
+  //   l = v_0^2/(2A) + f (dt - v_0/A)
+  // otherwise accelerating to f:
+  //   f^2 - f (A dt + v_0) + v_0^2/2 + A l = 0
+  dt = quantize(dt_1 + dt_m + dt_2, tq, &dq);
+  f = (l - pow(v_0, 2) / (2.0 * A)) / (dt - v_0 / A);
+  if (f > v_0) {
+    disc = pow(A * dt + v_0, 2) - 4 * (pow(v_0, 2) / 2.0 + A * l);
+    f = (A * dt + v_0 - sqrt(MAX(disc, 0))) / 2.0;
+  }
+  dt_1 = fabs(f - v_0) / A;
+  dt_2 = f / A;
+  dt_m = MAX(dt - dt_1 - dt_2, 0);
+  p->dt_1 = dt_1;
+  p->dt_2 = dt_2;
+  p->dt_m = dt_m;
+  p->a = dt_1 > 0 ? (f - v_0) / dt_1 : 0;
+  p->d = -(f / dt_2);
+  p->f = f;
+  p->dt = t + dt;
+  p->t_0 = t;
+  p->s_0 = s_0;
+  p->s_1 = p->l;
+  p->v_0 = v_0;
+  return 0;
+}
+
+// Plan from rest at lambda (restart within the block)
+int block_start_at(block_t *b, data_t lambda) {
+  assert(b);
+  block_profile_t *p = b->prof;
+  if (lambda <= 0) {
+    block_plan(b, 0, 0);
+  }
+  else if (lambda >= 1) { // nothing left to do
+    p->t_0 = p->dt = 0;
+    p->s_0 = p->s_1 = p->l;
+    p->dt_1 = p->dt_m = p->dt_2 = 0;
   }
   else {
-    r = b->prof->l;
-    *v = 0;
+    block_plan(b, 0, lambda * b->length);
   }
-  r /= b->prof->l;
-  *v *= 60; // convert to mm/min
-  return r;
+  return 0;
+}
+
+// Feed override
+int block_set_override(block_t *b, data_t factor) {
+  assert(b);
+  data_t override = b->override, feedrate = b->act_feedrate, acc = b->acc;
+  b->override = factor;
+  if (b->type == LINE || b->type == ARC_CW || b->type == ARC_CCW) {
+    if (block_feed(b)) { // keep the rates of the current plan
+      b->override = override;
+      b->act_feedrate = feedrate;
+      b->acc = acc;
+      return 1;
+    }
+  }
+  return 0;
 }
 
 // CAREFUL: this function allocates a point
@@ -243,7 +381,7 @@ point_t *block_interpolate(block_t *b, data_t lambda) {
   point_t *result = machine_setpoint(b->machine);
   point_t *p0 = point_zero(b);
 
-  if (b->type == LINE) {
+  if (b->type == LINE || b->type == RAPID) {
     point_set_x(result, point_x(p0) + point_x(b->delta) * lambda);
     point_set_y(result, point_y(p0) + point_y(b->delta) * lambda);
   }
@@ -278,6 +416,7 @@ block_getter(data_t, r, r);
 block_getter(point_t *, center, center);
 block_getter(block_t *, next, next);
 block_getter(point_t *, target, target);
+block_getter(data_t, override, override);
 
  
 
@@ -299,6 +438,12 @@ static data_t quantize(data_t t, data_t tq, data_t *dq) {
 
 // Calcultare the velocity profile
 static void block_compute(block_t *b) {
+  assert(b);
+  block_plan(b, 0, 0);
+}
+
+// Plan the profile from rest at time t_0 and position s_0 to the block end
+static void block_plan(block_t *b, data_t t_0, data_t s_0) {
   assert(b);
   data_t A, a, d;
   data_t dt, dt_1, dt_2, dt_m, dq;
@@ -306,7 +451,7 @@ static void block_compute(block_t *b) {
 
   A = b->acc;
   f_m = b->act_feedrate / 60.0;
-  l = b->length;
+  l = b->length - s_0;
   dt_1 = f_m / A;
   dt_2 = dt_1;
   dt_m = l /f_m - (dt_1 + dt_2) / 2.0;
@@ -332,8 +477,98 @@ static void block_compute(block_t *b) {
   b->prof->a = a;
   b->prof->d = d;
   b->prof->f = f_m;
-  b->prof->dt = dt;
-  b->prof->l = l;
+  b->prof->dt = t_0 + dt;
+  b->prof->l = b->length;
+  b->prof->t_0 = t_0;
+  b->prof->s_0 = s_0;
+  b->prof->s_1 = b->length;
+  b->prof->v_0 = 0;
+}
+
+// Set the actual feedrate and acceleration, with the feed override.
+// Returns 1 if the acceleration is not enough for the arc
+static int block_feed(block_t *b) {
+  data_t A = machine_A(b->machine);
+  b->act_feedrate = b->feedrate * b->override;
+  b->acc = A;
+  if (b->type == ARC_CW || b->type == ARC_CCW) {
+    // centripetal acc = f^2/r, must be <= A (a share of it, so that the
+    // tangential one below stays positive)
+    // INI file gives A in mm/s^2, feedrate is given in mm/min
+    b->act_feedrate = MIN(b->act_feedrate, sqrt(ARC_CENTRIPETAL * A * b->r) * 60);
+    // tangential acceleration: when composed with centripetal one, total
+    // acceleration must be <= A
+    // a^2 <= A^2 + v^4/r^2
+    b->acc = sqrt(pow(A, 2) - pow(b->act_feedrate / 60, 4) / pow(b->r, 2));
+    // deal with complex or null result: the profile divides by acc
+    if (isnan(b->acc) || b->acc <= 0) return 1;
+  }
+  return 0;
+}
+
+// Tangential acceleration allowed at speed v (mm/s): the block one, less
+// along arcs when v exceeds the feedrate it was computed for
+static data_t block_acc_at(const block_t *b, data_t v) {
+  data_t A = machine_A(b->machine);
+  if (b->type != ARC_CW && b->type != ARC_CCW) return b->acc;
+  return MIN(b->acc, sqrt(MAX(pow(A, 2) - pow(v, 4) / pow(b->r, 2), 0)));
+}
+
+// Position along the profile (mm) and speed (mm/s) at time t
+static data_t profile_position(const block_profile_t *p, data_t t, data_t *v) {
+  data_t r;
+  data_t dt_1 = p->dt_1;
+  data_t dt_2 = p->dt_2;
+  data_t dt_m = p->dt_m;
+  data_t a = p->a;
+  data_t d = p->d;
+  data_t f = p->f;
+
+  t -= p->t_0;
+  if (t < 0) {
+    r = p->s_0;
+    *v = 0.0;
+  }
+  else if (t < dt_1) { // acceleration (from v_0 to f)
+    r = p->s_0 + p->v_0 * t + a * pow(t, 2) / 2.0;
+    *v = p->v_0 + a * t;
+  }
+  else if (t < (dt_1 + dt_m)) { // maintenance
+    r = p->s_0 + p->v_0 * dt_1 / 2.0 + f * (dt_1 / 2.0 + (t - dt_1));
+    *v = f;
+  }
+  else if (t < (dt_1 + dt_m + dt_2)) { // deceleration
+    data_t t_2 = dt_1 + dt_m;
+    r = p->s_0 + p->v_0 * dt_1 / 2.0 + f * dt_1 / 2.0 + f * (dt_m + t - t_2) +
+      d / 2.0 * (pow(t, 2) + pow(t_2, 2)) - d * t * t_2;
+    *v = f + d * (t - dt_1 - dt_m);
+  }
+  else {
+    r = p->s_1;
+    *v = 0;
+  }
+  return r;
+}
+
+// Set feedrate and acceleration of a rapid: a straight line at the
+// highest values for which no axis exceeds its own rapid limits, i.e. the
+// axis limit scaled by length / axis displacement
+static void block_rapid(block_t *b) {
+  point_t *v = machine_rapid_v(b->machine);
+  point_t *a = machine_rapid_a(b->machine);
+  data_t d[3] = {
+    fabs(point_x(b->delta)), fabs(point_y(b->delta)), fabs(point_z(b->delta))
+  };
+  data_t v_max[3] = {point_x(v), point_y(v), point_z(v)};
+  data_t a_max[3] = {point_x(a), point_y(a), point_z(a)};
+  int i;
+  b->act_feedrate = INFINITY;
+  b->acc = INFINITY;
+  for (i = 0; i < 3; i++) {
+    if (d[i] == 0) continue;
+    b->act_feedrate = MIN(b->act_feedrate, v_max[i] * b->length / d[i]);
+    b->acc = MIN(b->acc, a_max[i] * b->length / d[i]);
+  }
 }
 
 // Calculate the arc coordinates
@@ -460,9 +695,150 @@ static int block_set_fields(block_t *b, char cmd, char *arg) {
 //    |_| |_____|____/ |_|   |_|  |_|\__,_|_|_| |_|
 //
 #ifdef BLOCK_MAIN
+// Replanning checks: each block runs tick by tick as the FSM steps it, with
+// holds and overrides at given times, and its path position is checked
+// after every tick: speed and acceleration (finite differences) within the
+// limits, holds stopping before the block end, and the end reached exactly.
+// Run from the directory holding settings.ini
+
+// Something happening during the run
+typedef struct {
+  data_t at;     // time, as a fraction of the initial block duration
+  char what;     // 'h' hold, 'o' override, 0 ends the list
+  data_t value;  // ticks held before resuming, or override factor
+} check_event_t;
+
+// A run from lambda_0, with its events
+typedef struct {
+  const char *name;
+  data_t lambda_0;     // start position (block_start_at())
+  int late;            // 1 if the hold comes while braking into the block
+                       // end, and may stop there
+  check_event_t ev[4];
+} check_run_t;
+
+#define CHECK_TOL 1E-6
+
+static int check_run(block_t *b, const char *name, const check_run_t *run) {
+  const check_event_t *ev = run->ev;
+  data_t A = machine_A(b->machine), tq = machine_tq(b->machine);
+  data_t lambda_0 = run->lambda_0;
+  data_t t = 0, t_end, v, v_prev = 0, s, s_prev, a, a_n;
+  data_t acc = 0, f = 0, a_max = 0, s_stop = -1;
+  int holding = 0, held = 0, stops = 0, fails = 0, done = 0;
+  // begin_interp
+  block_set_override(b, 1);
+  block_replan(b, 0);
+  if (lambda_0 > 0) block_start_at(b, lambda_0);
+  t_end = b->prof->dt;
+  s_prev = lambda_0 * b->length;
+  while (!done) {
+    if (held > 0) { // standing at the hold point, then resume (end_hold)
+      if (--held == 0) {
+        block_set_override(b, b->override);
+        block_resume(b, t);
+      }
+      s = s_prev;
+    }
+    else {
+      for (; ev->what && t + tq / 2.0 >= ev->at * t_end; ev++) {
+        if (ev->what == 'h' && !holding) { // begin_hold
+          block_hold(b, t);
+          holding = (int)ev->value;
+        }
+        else if (ev->what == 'o' && !holding &&
+                 !block_set_override(b, ev->value)) {
+          block_replan(b, t);
+        }
+      }
+      t += tq;
+      if (!holding && t >= block_dt(b) + tq / 2.0) { // end of the block
+        s = s_prev;
+        done = 1;
+      }
+      else {
+        s = block_lambda(b, t, &v) * b->length;
+      }
+      if (holding && t + tq / 2.0 >= block_dt(b)) { // feed_hold -> held
+        held = holding;
+        holding = 0;
+        s_stop = s;
+        stops++;
+      }
+    }
+    // limits so far: after an override, the profile may still brake from
+    // the previous speed, within the previous acceleration
+    acc = MAX(acc, b->acc);
+    f = MAX(f, b->act_feedrate / 60.0);
+    v = (s - s_prev) / tq;
+    a = (v - v_prev) / tq;
+    // along arcs, the total acceleration (with the centripetal one)
+    a_n = b->r > 0 ? pow(MAX(v, v_prev), 2) / b->r : 0;
+    a_max = MAX(a_max, fabs(a));
+    // only the first failure of a run is reported
+    if (v < -CHECK_TOL || v > f * (1 + CHECK_TOL) + CHECK_TOL) {
+      if (!fails++) printf("FAIL %s: speed %f mm/s at t = %f (max %f)\n", name, v, t, f);
+    }
+    if (fabs(a) > MIN(acc, A) * (1 + CHECK_TOL) + CHECK_TOL) {
+      if (!fails++) printf("FAIL %s: acceleration %f mm/s^2 at t = %f (max %f)\n", name, a, t, acc);
+    }
+    if (hypot(a, a_n) > A * (1 + CHECK_TOL) + CHECK_TOL) {
+      if (!fails++) printf("FAIL %s: total acceleration %f mm/s^2 at t = %f\n", name, hypot(a, a_n), t);
+    }
+    s_prev = s;
+    v_prev = v;
+    if (t > 1000 * t_end) {
+      printf("FAIL %s: never ends\n", name);
+      return fails + 1;
+    }
+  }
+  if (stops && !run->late && s_stop >= b->length - CHECK_TOL) {
+    printf("FAIL %s: the hold stopped at the block end\n", name);
+    fails++;
+  }
+  if (fabs(s - b->length) > CHECK_TOL) {
+    printf("FAIL %s: ends at %f of %f\n", name, s, b->length);
+    fails++;
+  }
+  if (!fails) {
+    printf("ok   %s: %.3f s, max acceleration %.2f of %.2f mm/s^2%s\n", name,
+      t, a_max, acc, stops ? ", held" : "");
+  }
+  return fails;
+}
+
+static int check_block(block_t *b, const char *name) {
+  char label[64];
+  int fails = 0;
+  static const check_run_t runs[] = {
+    {"plain", 0, 0, {{0}}},
+    {"hold", 0, 0, {{0.3, 'h', 10}, {0}}},
+    {"hold at start", 0, 0, {{0, 'h', 10}, {0}}},
+    {"hold in braking", 0, 1, {{0.99, 'h', 10}, {0}}},
+    {"override up", 0, 0, {{0.3, 'o', 2}, {0}}},
+    {"override down", 0, 0, {{0.3, 'o', 0.5}, {0}}},
+    {"override down in braking", 0, 0, {{0.9, 'o', 0.3}, {0}}},
+    {"override up in braking", 0, 0, {{0.9, 'o', 2}, {0}}},
+    {"override up, down, up", 0, 0, {{0.1, 'o', 2}, {0.2, 'o', 0.3}, {0.5, 'o', 1.5}, {0}}},
+    {"override, then hold", 0, 0, {{0.2, 'o', 0.5}, {0.5, 'h', 5}, {0.7, 'o', 2}, {0}}},
+    {"override down, then hold", 0, 0, {{0.3, 'o', 0.2}, {0.31, 'h', 5}, {0}}},
+    {"start at", 0.4, 0, {{0}}},
+    {"start at, override up", 0.4, 0, {{0.1, 'o', 2}, {0}}},
+    {"start at, hold", 0.4, 0, {{0.2, 'h', 10}, {0}}},
+  };
+  size_t i;
+  for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+    snprintf(label, sizeof(label), "%s, %s", name, runs[i].name);
+    fails += check_run(b, label, &runs[i]);
+  }
+  return fails;
+}
+
 int main() {
-  block_t *b1 = NULL, *b2 = NULL, *b3 = NULL;
-  machine_t *cfg = machine_new(NULL);
+  block_t *b1 = NULL, *b2 = NULL, *b3 = NULL, *b4 = NULL, *b5 = NULL;
+  machine_t *cfg = machine_new("settings.ini");
+  int fails = 0;
+  if (!cfg) return 1;
 
   b1 = block_new("N10 G00 X90 Y90 Z100 t3", NULL, cfg);
   block_parse(b1);
@@ -470,14 +846,30 @@ int main() {
   block_parse(b2);
   b3 = block_new("N30 G01 Y200", b2, cfg);
   block_parse(b3);
+  // an arc at a feedrate that the override pushes beyond the centripetal
+  // limit, and a short line that never reaches its feedrate
+  b4 = block_new("N40 G02 X140 Y200 I20 J0 F1500", b3, cfg);
+  block_parse(b4);
+  b5 = block_new("N50 G01 X141 F3000", b4, cfg);
+  block_parse(b5);
 
   block_print(b1, stdout);
   block_print(b2, stdout);
   block_print(b3, stdout);
+  block_print(b4, stdout);
+  block_print(b5, stdout);
+
+  fails += check_block(b3, "line");
+  fails += check_block(b4, "arc");
+  fails += check_block(b5, "short line");
+  printf("%d failure(s)\n", fails);
 
   block_free(b1);
   block_free(b2);
   block_free(b3);
-  return 0;
+  block_free(b4);
+  block_free(b5);
+  machine_free(cfg);
+  return fails > 0;
 }
-#endif
\ No newline at end of file
+#endif
@@ -53,7 +53,35 @@ int block_parse(block_t *b);
 // also return speed in the parameter v
 data_t block_lambda(const block_t *b, data_t time, data_t *v);
 
-// Interpolate lambda over three axes
+// Feed hold: replan the profile at the given time into a deceleration to
+// rest, at the block acceleration and from the current position and speed;
+// block_dt() then returns the stop time. Past the planned deceleration
+// point, the profile is kept: it stops at the block end. Only for feed
+// moves: rapids, even when interpolated, are held at their target (see
+// ccnc_do_rapid_motion()). Returns 0 on success
+int block_hold(block_t *b, data_t time);
+
+// Resume after block_hold(), once at rest: replan the acceleration from
+// the held position to the block end; block_dt() returns the new end time.
+// Returns 0 on success, 1 if the block is still moving
+int block_resume(block_t *b, data_t time);
+
+// Feed override: scale the programmed feedrate by factor (the arc limits
+// still apply). Only rates, not the profile: see block_replan().
+// Returns 1, keeping the previous rates, if the arc cannot be run
+int block_set_override(block_t *b, data_t factor);
+
+// Replan the rest of the profile from the position and speed at the given
+// time, reaching the current feedrate within the block acceleration; at
+// time 0 this is the plan made when parsing. Returns 0 on success
+int block_replan(block_t *b, data_t time);
+
+// Plan the profile from rest at the given lambda to the block end, e.g.
+// to restart from a checkpoint. Returns 0 on success
+int block_start_at(block_t *b, data_t lambda);
+
+// Interpolate lambda over three axes. Rapids are straight lines, and only
+// have a profile when the machine interpolates them (machine_rapid_interp())
 point_t *block_interpolate(block_t *b, data_t lambda);
 
 
@@ -69,6 +97,7 @@ size_t block_n(const block_t *b);
 point_t *block_center(const block_t *b);
 block_t *block_next(const block_t *b);
 point_t *block_target(const block_t *b);
+data_t block_override(const block_t *b);
 
 
 #endif // BLOCK_H
\ No newline at end of file
@@ -0,0 +1,229 @@
+//    ____ _               _                _       _
+//   / ___| |__   ___  ___| | ___ __   ___ (_)_ __ | |_
+//  | |   | '_ \ / _ \/ __| |/ / '_ \ / _ \| | '_ \| __|
+//  | |___| | | |  __/ (__|   <| |_) | (_) | | | | | |_
+//   \____|_| |_|\___|\___|_|\_\ .__/ \___/|_|_| |_|\__|
+//                             |_|
+
+#include "checkpoint.h"
+#include "inic.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define BUFLEN 1024
+#define MAGIC "CCNCCKP1"
+
+typedef struct {
+  uint64_t seq;              // 0: never written
+  checkpoint_state_t st;
+  uint64_t sum;              // FNV-1a of seq and st
+} slot_t;
+
+// File contents
+typedef struct {
+  char magic[8];
+  uint32_t size;             // sizeof(checkpoint_state_t)
+  uint32_t reserved;
+  slot_t slot[2];
+} ckpt_file_t;
+
+// Checkpoint object structure
+typedef struct checkpoint {
+  int enabled;
+  char path[2 * BUFLEN];
+  int every, ticks;          // ticks between saves, and since the last one
+  data_t safe_z, approach_feed;
+  ckpt_file_t *file;         // mapping
+  uint64_t seq;              // last sequence number written
+  int resumable;             // last is an interrupted job
+  checkpoint_state_t last;   // state found at startup
+} checkpoint_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int map_file(checkpoint_t *c);
+static uint64_t slot_sum(const slot_t *s);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+checkpoint_t *checkpoint_new(const char *ini_path, const char *id) {
+  assert(ini_path);
+  void *ini;
+  char file[BUFLEN], *ext;
+  checkpoint_t *c = (checkpoint_t *)calloc(1, sizeof(checkpoint_t));
+  if (!c) {
+    perror("Could not allocate checkpoint");
+    return NULL;
+  }
+  ini = ini_init(ini_path);
+  if (!ini) {
+    eprintf("Could not open the ini file %s\n", ini_path);
+    free(c);
+    return NULL;
+  }
+  // all optional
+  if (ini_get_int(ini, "CHECKPOINT", "enabled", &c->enabled))
+    c->enabled = 0;
+  if (ini_get_char(ini, "CHECKPOINT", "file", file, BUFLEN))
+    strcpy(file, "c-cnc.ckp");
+  if (ini_get_int(ini, "CHECKPOINT", "every", &c->every) || c->every < 1)
+    c->every = 10;
+  if (ini_get_double(ini, "CHECKPOINT", "safe_z", &c->safe_z))
+    c->safe_z = NAN;
+  if (ini_get_double(ini, "CHECKPOINT", "approach_feed", &c->approach_feed) ||
+      c->approach_feed <= 0)
+    c->approach_feed = 300;
+  ini_free(ini);
+  if (!c->enabled) return c;
+  // c-cnc.ckp -> c-cnc-<id>.ckp
+  if (id) {
+    ext = strrchr(file, '.');
+    if (ext && !strchr(ext, '/')) {
+      snprintf(c->path, sizeof(c->path), "%.*s-%s%s", (int)(ext - file), file, id, ext);
+    }
+    else {
+      snprintf(c->path, sizeof(c->path), "%s-%s", file, id);
+    }
+  }
+  else {
+    strncpy(c->path, file, sizeof(c->path) - 1);
+  }
+  if (map_file(c)) {
+    free(c);
+    return NULL;
+  }
+  return c;
+}
+
+void checkpoint_free(checkpoint_t *c) {
+  assert(c);
+  if (c->file) munmap(c->file, sizeof(ckpt_file_t));
+  free(c);
+  c = NULL;
+}
+
+
+// SAVING (realtime side) ======================================================
+
+int checkpoint_due(checkpoint_t *c) {
+  assert(c);
+  if (!c->file || ++c->ticks < c->every) return 0;
+  c->ticks = 0;
+  return 1;
+}
+
+void checkpoint_save(checkpoint_t *c, const checkpoint_state_t *st) {
+  assert(c && st);
+  if (!c->file) return;
+  // overwrite the older slot: the newer one stays valid meanwhile
+  slot_t *s = &c->file->slot[(c->seq + 1) & 1];
+  s->seq = ++c->seq;
+  s->st = *st;
+  s->sum = slot_sum(s);
+}
+
+void checkpoint_done(checkpoint_t *c) {
+  assert(c);
+  checkpoint_state_t st = {.active = 0};
+  checkpoint_save(c, &st);
+}
+
+
+// GETTERS =====================================================================
+
+int checkpoint_enabled(const checkpoint_t *c) {
+  assert(c);
+  return c->enabled;
+}
+
+int checkpoint_last(const checkpoint_t *c, checkpoint_state_t *st) {
+  assert(c && st);
+  *st = c->last;
+  return c->resumable;
+}
+
+data_t checkpoint_safe_z(const checkpoint_t *c) {
+  assert(c);
+  return c->safe_z;
+}
+
+data_t checkpoint_approach_feed(const checkpoint_t *c) {
+  assert(c);
+  return c->approach_feed;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Map the file (created, or reset if its layout differs) and pick the
+// newest valid slot
+static int map_file(checkpoint_t *c) {
+  int fd, i, newest = -1;
+  ckpt_file_t *f;
+  fd = open(c->path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    perror("Could not open the checkpoint file");
+    return 1;
+  }
+  if (ftruncate(fd, sizeof(ckpt_file_t))) {
+    perror("Could not size the checkpoint file");
+    close(fd);
+    return 1;
+  }
+  f = (ckpt_file_t *)mmap(NULL, sizeof(ckpt_file_t), PROT_READ | PROT_WRITE,
+    MAP_SHARED, fd, 0);
+  // the mapping stays valid without the descriptor
+  close(fd);
+  if (f == MAP_FAILED) {
+    perror("Could not map the checkpoint file");
+    return 1;
+  }
+  c->file = f;
+  if (memcmp(f->magic, MAGIC, sizeof(f->magic)) || f->size != sizeof(checkpoint_state_t)) {
+    memset(f, 0, sizeof(ckpt_file_t));
+    memcpy(f->magic, MAGIC, sizeof(f->magic));
+    f->size = sizeof(checkpoint_state_t);
+    return 0;
+  }
+  for (i = 0; i < 2; i++) {
+    if (f->slot[i].seq == 0 || f->slot[i].sum != slot_sum(&f->slot[i])) continue;
+    if (newest < 0 || f->slot[i].seq > f->slot[newest].seq) newest = i;
+  }
+  if (newest >= 0) {
+    c->seq = f->slot[newest].seq;
+    c->last = f->slot[newest].st;
+    c->last.program[CHECKPOINT_PATHLEN - 1] = '\0';
+    c->resumable = c->last.active;
+  }
+  return 0;
+}
+
+static uint64_t slot_sum(const slot_t *s) {
+  const unsigned char *p = (const unsigned char *)s;
+  size_t i, len = offsetof(slot_t, sum);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
@@ -0,0 +1,93 @@
+//    ____ _               _                _       _
+//   / ___| |__   ___  ___| | ___ __   ___ (_)_ __ | |_
+//  | |   | '_ \ / _ \/ __| |/ / '_ \ / _ \| | '_ \| __|
+//  | |___| | | |  __/ (__|   <| |_) | (_) | | | | | |_
+//   \____|_| |_|\___|\___|_|\_\ .__/ \___/|_|_| |_|\__|
+//                             |_|
+//  Checkpoint class
+//  Execution state (program, block, position along it, timers, setpoint,
+//  feed override) saved every few ticks into a memory-mapped file, so that
+//  a job interrupted by a crash can be resumed. Saving is a copy into the
+//  mapping, with no system calls: the kernel writes the pages back, and
+//  they survive the process.
+//  The file holds two slots, written alternately, each with a sequence
+//  number and a checksum: a save torn by a crash fails the checksum, and
+//  the previous slot is used instead.
+//
+//  File layout (native endianness):
+//    header   "CCNCCKP1", u32 state size, u32 0
+//    slots    2 x {u64 seq, checkpoint_state_t, u64 FNV-1a of both}
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct checkpoint checkpoint_t;
+
+#define CHECKPOINT_PATHLEN 512
+
+// Execution state
+typedef struct {
+  uint32_t active;      // 1 while a job runs, 0 once it is completed
+  uint32_t state;       // FSM state
+  char program[CHECKPOINT_PATHLEN]; // G-code file
+  uint64_t index;       // current block, position in the program
+  uint64_t n;           // current block number
+  data_t t_tot, t_blk;  // timers
+  data_t lambda;        // position along the current block
+  data_t x, y, z;       // setpoint
+  data_t override;      // feed override factor
+} checkpoint_state_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Read the [CHECKPOINT] section of the INI file (all optional: enabled,
+// default 0; file, default c-cnc.ckp, tagged with id if not NULL; every,
+// ticks between saves, default 10; safe_z and approach_feed, for the
+// approach move when resuming) and map the file, keeping the state found
+// there. Returns NULL on failure
+checkpoint_t *checkpoint_new(const char *ini_path, const char *id);
+
+void checkpoint_free(checkpoint_t *c);
+
+// SAVING (realtime side) ======================================================
+
+// Call once per tick: returns 1 every few ticks, when a save is due
+int checkpoint_due(checkpoint_t *c);
+
+// Save the state (a memory copy)
+void checkpoint_save(checkpoint_t *c, const checkpoint_state_t *st);
+
+// The job was completed: there is nothing to resume
+void checkpoint_done(checkpoint_t *c);
+
+// GETTERS =====================================================================
+
+int checkpoint_enabled(const checkpoint_t *c);
+
+// State left by the previous run, as found by checkpoint_new(). Returns 1
+// if it is an interrupted job, 0 otherwise
+int checkpoint_last(const checkpoint_t *c, checkpoint_state_t *st);
+
+// Safe height for the approach moves (NAN if not set) and approach
+// feedrate (mm/min)
+data_t checkpoint_safe_z(const checkpoint_t *c);
+data_t checkpoint_approach_feed(const checkpoint_t *c);
+
+#endif // CHECKPOINT_H
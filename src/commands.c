@@ -0,0 +1,239 @@
+//    ____                                          _
+//   / ___|___  _ __ ___  _ __ ___   __ _ _ __   __| |___
+//  | |   / _ \| '_ ` _ \| '_ ` _ \ / _` | '_ \ / _` / __|
+//  | |__| (_) | | | | | | | | | | | (_| | | | | (_| \__ \
+//   \____\___/|_| |_| |_|_| |_| |_|\__,_|_| |_|\__,_|___/
+//
+
+#include "commands.h"
+#include "inic.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define BUFLEN 1024
+
+// Commands object structure
+typedef struct commands {
+  int in;                    // stdin, -1 if not used (or closed)
+  int tty;                   // stdin is a terminal
+  struct termios tio;        // terminal settings to restore
+  int in_flags;              // stdin file status flags to restore
+  char keys[BUFLEN];         // keys read, not consumed yet
+  size_t n_keys, next_key;
+  int sock;                  // command socket, -1 if none
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+} commands_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int open_socket(commands_t *c);
+static int parse(const char *text, command_t *cmd);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+commands_t *commands_new(const char *ini_path, int use_stdin) {
+  assert(ini_path);
+  struct termios tio;
+  void *ini;
+  commands_t *c = (commands_t *)calloc(1, sizeof(commands_t));
+  if (!c) {
+    perror("Could not allocate commands");
+    return NULL;
+  }
+  c->in = c->sock = -1;
+  ini = ini_init(ini_path);
+  if (!ini) {
+    eprintf("Could not open the ini file %s\n", ini_path);
+    free(c);
+    return NULL;
+  }
+  // optional
+  ini_get_char(ini, "C-CNC", "command_socket", c->path, sizeof(c->path));
+  ini_free(ini);
+  if (c->path[0] && open_socket(c)) {
+    free(c);
+    return NULL;
+  }
+  if (use_stdin) {
+    c->in = STDIN_FILENO;
+    c->tty = isatty(c->in);
+    if (c->tty && tcgetattr(c->in, &c->tio) == 0) {
+      // keys without Enter and without echo, reads never block; unlike
+      // cfmakeraw(), Ctrl-C still raises SIGINT
+      tio = c->tio;
+      tio.c_lflag &= ~(ICANON | ECHO);
+      tio.c_cc[VMIN] = 0;
+      tio.c_cc[VTIME] = 0;
+      tcsetattr(c->in, TCSANOW, &tio);
+    }
+    else {
+      c->tty = 0;
+      c->in_flags = fcntl(c->in, F_GETFL);
+      fcntl(c->in, F_SETFL, c->in_flags | O_NONBLOCK);
+    }
+  }
+  return c;
+}
+
+void commands_free(commands_t *c) {
+  assert(c);
+  if (c->in >= 0) {
+    if (c->tty) tcsetattr(c->in, TCSANOW, &c->tio);
+    else fcntl(c->in, F_SETFL, c->in_flags);
+  }
+  if (c->sock >= 0) {
+    close(c->sock);
+    unlink(c->path);
+  }
+  free(c);
+  c = NULL;
+}
+
+
+// INPUT =======================================================================
+
+int commands_poll(commands_t *c, int idle, command_t *cmd) {
+  assert(c && cmd);
+  char buf[BUFLEN];
+  ssize_t n;
+  // socket commands first: they are complete
+  while (c->sock >= 0 && (n = recv(c->sock, buf, BUFLEN - 1, 0)) >= 0) {
+    buf[n] = '\0';
+    if (parse(buf, cmd) == 0) return 1;
+    eprintf("Unknown command: %s\n", buf);
+  }
+  if (c->in < 0 || (!idle && !c->tty)) return 0;
+  if (c->next_key == c->n_keys) {
+    c->next_key = c->n_keys = 0;
+    n = read(c->in, c->keys, BUFLEN);
+    // a closed pipe: nothing more will come
+    if (n == 0 && !c->tty) c->in = -1;
+    if (n <= 0) return 0;
+    c->n_keys = n;
+  }
+  memset(cmd, 0, sizeof(*cmd));
+  while (c->next_key < c->n_keys && cmd->type == CMD_NONE) {
+    switch (c->keys[c->next_key++]) {
+    case ' ':
+    case 'r':
+    case 'R':
+      cmd->type = CMD_START;
+      break;
+    case 'q':
+    case 'Q':
+      cmd->type = CMD_STOP;
+      break;
+    case 'p':
+    case 'P':
+      cmd->type = CMD_TOGGLE;
+      break;
+    case 'h':
+    case 'H':
+      cmd->type = CMD_HOLD;
+      break;
+    case 'c':
+    case 'C':
+      cmd->type = CMD_CONTINUE;
+      break;
+    case '+':
+    case '-':
+      cmd->type = CMD_FEED;
+      snprintf(cmd->arg, COMMAND_ARGLEN, "%c10", c->keys[c->next_key - 1]);
+      break;
+    default:
+      break;
+    }
+  }
+  return cmd->type != CMD_NONE;
+}
+
+void commands_wait(commands_t *c, int timeout_ms) {
+  assert(c);
+  struct pollfd pfd[2];
+  nfds_t n = 0;
+  if (c->next_key < c->n_keys) return;
+  if (c->sock >= 0) pfd[n++] = (struct pollfd){.fd = c->sock, .events = POLLIN};
+  if (c->in >= 0) pfd[n++] = (struct pollfd){.fd = c->in, .events = POLLIN};
+  poll(pfd, n, timeout_ms);
+}
+
+
+// GETTERS =====================================================================
+
+int commands_fd(const commands_t *c) {
+  assert(c);
+  return c->sock;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__\___|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+static int open_socket(commands_t *c) {
+  struct sockaddr_un sun = {.sun_family = AF_UNIX};
+  strncpy(sun.sun_path, c->path, sizeof(sun.sun_path) - 1);
+  c->sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (c->sock < 0) {
+    perror("Could not create command socket");
+    return 1;
+  }
+  // a stale socket file from a previous run would make bind() fail
+  unlink(c->path);
+  if (bind(c->sock, (struct sockaddr *)&sun, sizeof(sun))) {
+    perror("Could not bind command socket");
+    close(c->sock);
+    return 1;
+  }
+  fcntl(c->sock, F_SETFL, fcntl(c->sock, F_GETFL) | O_NONBLOCK);
+  eprintf("-> Accepting commands on %s\n", c->path);
+  return 0;
+}
+
+// "start", "stop", "pause", "hold", "resume", "feed <percent>",
+// "load <file>", "queue <file>", "continue", with trailing blanks
+static int parse(const char *text, command_t *cmd) {
+  static const struct {
+    const char *name;
+    command_type_t type;
+  } names[] = {
+    {"start", CMD_START}, {"stop", CMD_STOP}, {"quit", CMD_STOP},
+    {"pause", CMD_PAUSE}, {"hold", CMD_HOLD}, {"resume", CMD_RESUME},
+    {"feed", CMD_FEED}, {"load", CMD_LOAD}, {"queue", CMD_QUEUE},
+    {"continue", CMD_CONTINUE}
+  };
+  char word[16] = "";
+  size_t i;
+  int len = 0;
+  memset(cmd, 0, sizeof(*cmd));
+  if (sscanf(text, " %15s %n", word, &len) != 1) return 1;
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (strcmp(word, names[i].name) == 0) break;
+  }
+  if (i == sizeof(names) / sizeof(names[0])) return 1;
+  cmd->type = names[i].type;
+  strncpy(cmd->arg, text + len, COMMAND_ARGLEN - 1);
+  // strip the newline of e.g. echo
+  cmd->arg[strcspn(cmd->arg, "\r\n")] = '\0';
+  if (cmd->type == CMD_LOAD && !cmd->arg[0]) return 1;
+  return 0;
+}
@@ -0,0 +1,84 @@
+//    ____                                          _
+//   / ___|___  _ __ ___  _ __ ___   __ _ _ __   __| |___
+//  | |   / _ \| '_ ` _ \| '_ ` _ \ / _` | '_ \ / _` / __|
+//  | |__| (_) | | | | | | | | | | | (_| | | | | (_| \__ \
+//   \____\___/|_| |_| |_|_| |_| |_|\__,_|_| |_|\__,_|___/
+//  Commands class
+//  Non-blocking operator input, read by the FSM at every tick: single keys
+//  on stdin (the terminal is set to unbuffered, no-echo mode for the whole
+//  session, keeping Ctrl-C), and text commands on an optional Unix
+//  datagram socket, one per datagram:
+//    start | stop | pause | hold | resume | feed <[+|-]percent>
+//    load <G-code file> | queue <G-code file> | continue
+//  e.g.: echo pause | socat - UNIX-SENDTO:/tmp/c-cnc.cmd
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct commands commands_t;
+
+typedef enum {
+  CMD_NONE = 0,
+  CMD_START,            // key r or spacebar (also resumes)
+  CMD_STOP,             // key q: quit
+  CMD_PAUSE,
+  CMD_RESUME,
+  CMD_TOGGLE,           // key p: pause or resume
+  CMD_HOLD,             // key h: feed hold, stop now along the path (rapids
+                        // stop at their target)
+  CMD_FEED,             // keys + and -: feed override, percent in arg
+  CMD_LOAD,             // socket only: load the program in arg
+  CMD_QUEUE,            // socket only: append the program in arg to the jobs
+  CMD_CONTINUE          // key c: resume an interrupted job from its checkpoint
+} command_type_t;
+
+#define COMMAND_ARGLEN 512
+
+typedef struct {
+  command_type_t type;
+  char arg[COMMAND_ARGLEN];
+} command_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Read [C-CNC] command_socket from the INI file (optional) and, if
+// use_stdin, take over stdin. Returns NULL on failure
+commands_t *commands_new(const char *ini_path, int use_stdin);
+
+// Restore the terminal and remove the socket
+void commands_free(commands_t *c);
+
+// INPUT =======================================================================
+
+// Read the next command, never blocking. Returns 1 if cmd was filled in,
+// 0 if there is nothing new. Outside idle, keys from a stdin that is not
+// a terminal (a script, like printf 'rq' | c-cnc) are left for later: they
+// are answers to the idle prompt
+int commands_poll(commands_t *c, int idle, command_t *cmd);
+
+// Wait up to timeout_ms milliseconds for input (for unpaced loops)
+void commands_wait(commands_t *c, int timeout_ms);
+
+// GETTERS =====================================================================
+
+// Socket, for polling; -1 if none
+int commands_fd(const commands_t *c);
+
+#endif // COMMANDS_H
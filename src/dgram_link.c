@@ -0,0 +1,222 @@
+//   ____                              _     _       _
+//  |  _ \  __ _ _ __ __ _ _ __ ___   | |   (_)_ __ | | __
+//  | | | |/ _` | '__/ _` | '_ ` _ \  | |   | | '_ \| |/ /
+//  | |_| | (_| | | | (_| | | | | | | | |___| | | | |   <
+//  |____/ \__, |_|  \__,_|_| |_| |_| |_____|_|_| |_|_|\_\
+//         |___/
+
+#include "dgram_link.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// Link object structure
+typedef struct dgram_link {
+  int fd;                              // socket
+  dgram_family_t family;
+  struct sockaddr_storage remote;      // peer address
+  socklen_t remote_len;
+  char local_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  uint64_t tx_session;                 // this side's session id
+  uint64_t tx_seq;                     // next sequence number to send
+  uint64_t rx_session;                 // peer session id
+  int rx_synced;                       // rx_session is known
+  uint64_t rx_seq;                     // next expected sequence number
+  uint64_t rx_window;                  // bit i: rx_seq - 1 - i arrived
+  dgram_stats_t stats;
+} dgram_link_t;
+
+// sequence numbers tracked below the newest one, for the late arrivals
+#define DGRAM_WINDOW 64
+
+static const char *side_names[] = {"controller", "machine"};
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int udp_address(const char *host, int port, struct sockaddr_storage *sa, socklen_t *len);
+static socklen_t unix_address(const char *prefix, dgram_side_t side, struct sockaddr_storage *sa);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+dgram_link_t *dgram_link_open(dgram_family_t family, const char *addr, int port, dgram_side_t side) {
+  assert(addr);
+  struct sockaddr_storage local;
+  socklen_t local_len;
+  dgram_side_t other = (side == DGRAM_CONTROLLER) ? DGRAM_MACHINE : DGRAM_CONTROLLER;
+  dgram_link_t *l = (dgram_link_t *)calloc(1, sizeof(dgram_link_t));
+  if (!l) {
+    perror("Could not allocate datagram link");
+    return NULL;
+  }
+  l->family = family;
+  // unique enough across restarts of either side
+  l->tx_session = now_ns() ^ ((uint64_t)getpid() << 40);
+  if (family == DGRAM_UDP) {
+    if (udp_address(addr, port + side, &local, &local_len) ||
+        udp_address(addr, port + other, &l->remote, &l->remote_len)) {
+      free(l);
+      return NULL;
+    }
+  }
+  else {
+    local_len = unix_address(addr, side, &local);
+    l->remote_len = unix_address(addr, other, &l->remote);
+    strncpy(l->local_path, ((struct sockaddr_un *)&local)->sun_path, sizeof(l->local_path) - 1);
+    // a stale socket file from a previous run would make bind() fail
+    unlink(l->local_path);
+  }
+  l->fd = socket(local.ss_family, SOCK_DGRAM, 0);
+  if (l->fd < 0) {
+    perror("Could not create socket");
+    free(l);
+    return NULL;
+  }
+  if (bind(l->fd, (struct sockaddr *)&local, local_len)) {
+    perror("Could not bind socket");
+    close(l->fd);
+    free(l);
+    return NULL;
+  }
+  fcntl(l->fd, F_SETFL, fcntl(l->fd, F_GETFL) | O_NONBLOCK);
+  eprintf("-> Datagram link bound as %s\n", side_names[side]);
+  return l;
+}
+
+void dgram_link_close(dgram_link_t *l) {
+  assert(l);
+  close(l->fd);
+  if (l->family == DGRAM_UNIX) {
+    unlink(l->local_path);
+  }
+  free(l);
+  l = NULL;
+}
+
+
+// COMMUNICATIONS ==============================================================
+
+int dgram_link_send(dgram_link_t *l, dgram_msg_t *msg) {
+  assert(l && msg);
+  msg->magic = DGRAM_MAGIC;
+  msg->session = l->tx_session;
+  msg->seq = l->tx_seq++;
+  msg->t_sent = now_ns();
+  if (sendto(l->fd, msg, sizeof(dgram_msg_t), 0,
+      (struct sockaddr *)&l->remote, l->remote_len) != sizeof(dgram_msg_t)) {
+    // peer not there (yet): the packet is simply lost, like on the wire
+    if (errno == ECONNREFUSED || errno == ENOENT || errno == EAGAIN)
+      return 1;
+    perror("Could not send datagram");
+    return 1;
+  }
+  l->stats.sent++;
+  return 0;
+}
+
+int dgram_link_recv(dgram_link_t *l, dgram_msg_t *msg) {
+  assert(l && msg);
+  ssize_t n;
+  uint64_t d;
+  while ((n = recv(l->fd, msg, sizeof(dgram_msg_t), 0)) >= 0) {
+    if (n != sizeof(dgram_msg_t) || msg->magic != DGRAM_MAGIC) continue;
+    // first packet, or the peer restarted: its numbering starts here, and
+    // nothing before it was counted as lost
+    if (!l->rx_synced || msg->session != l->rx_session) {
+      l->rx_synced = 1;
+      l->rx_session = msg->session;
+      l->rx_seq = msg->seq;
+      l->rx_window = ~0ULL;
+    }
+    if (msg->seq < l->rx_seq) { // late or duplicate packet, already superseded
+      d = l->rx_seq - 1 - msg->seq;
+      if (d < DGRAM_WINDOW && (l->rx_window & (1ULL << d))) {
+        l->stats.duplicated++;
+        continue;
+      }
+      l->stats.reordered++;
+      // a late one was counted as lost when its gap was detected
+      if (d < DGRAM_WINDOW) {
+        l->rx_window |= 1ULL << d;
+        l->stats.lost--;
+      }
+      continue;
+    }
+    d = msg->seq + 1 - l->rx_seq;
+    l->rx_window = (d < DGRAM_WINDOW ? l->rx_window << d : 0) | 1;
+    l->stats.lost += msg->seq - l->rx_seq;
+    l->rx_seq = msg->seq + 1;
+    l->stats.received++;
+    return 1;
+  }
+  return 0;
+}
+
+int dgram_link_wait(dgram_link_t *l, dgram_msg_t *msg, int timeout_ms) {
+  assert(l && msg);
+  struct pollfd pfd = {.fd = l->fd, .events = POLLIN};
+  if (dgram_link_recv(l, msg)) return 1;
+  if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+  return dgram_link_recv(l, msg);
+}
+
+
+// GETTERS =====================================================================
+
+void dgram_link_stats(const dgram_link_t *l, dgram_stats_t *stats) {
+  assert(l && stats);
+  *stats = l->stats;
+}
+
+int dgram_link_fd(const dgram_link_t *l) {
+  assert(l);
+  return l->fd;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+static int udp_address(const char *host, int port, struct sockaddr_storage *sa, socklen_t *len) {
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM};
+  struct addrinfo *res;
+  char service[16];
+  int rc;
+  snprintf(service, sizeof(service), "%d", port);
+  if ((rc = getaddrinfo(host, service, &hints, &res))) {
+    eprintf("Cannot resolve %s: %s\n", host, gai_strerror(rc));
+    return 1;
+  }
+  memcpy(sa, res->ai_addr, res->ai_addrlen);
+  *len = res->ai_addrlen;
+  freeaddrinfo(res);
+  return 0;
+}
+
+static socklen_t unix_address(const char *prefix, dgram_side_t side, struct sockaddr_storage *sa) {
+  struct sockaddr_un *sun = (struct sockaddr_un *)sa;
+  memset(sa, 0, sizeof(*sa));
+  sun->sun_family = AF_UNIX;
+  snprintf(sun->sun_path, sizeof(sun->sun_path), "%s-%s.sock", prefix, side_names[side]);
+  return sizeof(struct sockaddr_un);
+}
@@ -0,0 +1,104 @@
+//   ____                              _     _       _
+//  |  _ \  __ _ _ __ __ _ _ __ ___   | |   (_)_ __ | | __
+//  | | | |/ _` | '__/ _` | '_ ` _ \  | |   | | '_ \| |/ /
+//  | |_| | (_| | | | (_| | | | | | | | |___| | | | |   <
+//  |____/ \__, |_|  \__,_|_| |_| |_| |_____|_|_| |_|_|\_\
+//         |___/
+//  Datagram link class
+//  Sequence-numbered setpoint/status packets over UDP (on localhost or a
+//  dedicated link) or over Unix-domain datagram sockets. No broker, no
+//  retransmissions: the receiver keeps the newest packet and counts the
+//  ones that went missing or arrived out of order. Every link opened is a
+//  new session: a restarted peer numbers its packets from 0 again, and the
+//  receiver resynchronizes on its session id.
+
+#ifndef DGRAM_LINK_H
+#define DGRAM_LINK_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct dgram_link dgram_link_t;
+
+// Packet exchanged in both directions. Setpoints use x, y, z and rapid;
+// status packets use x, y, z (actual position) and error, and echo sp_seq
+// and sp_time of the last setpoint received.
+typedef struct {
+  uint32_t magic;       // DGRAM_MAGIC, anything else is discarded
+  uint32_t rapid;       // rapid motion flag
+  uint64_t session;     // sender session id, set by dgram_link_open()
+  uint64_t seq;         // packet sequence number, set by dgram_link_send()
+  uint64_t t_sent;      // packet send time (ns, see now_ns())
+  uint64_t sp_seq;      // setpoint sequence number
+  uint64_t sp_time;     // setpoint send time (ns)
+  data_t x, y, z;       // coordinates
+  data_t error;         // positioning error
+} dgram_msg_t;
+
+#define DGRAM_MAGIC 0x434e4332 // "CNC2"
+
+// Address family
+typedef enum {
+  DGRAM_UDP = 0,
+  DGRAM_UNIX
+} dgram_family_t;
+
+// Link side: the controller binds on port (or path-controller.sock), the
+// machine binds on port + 1 (or path-machine.sock)
+typedef enum {
+  DGRAM_CONTROLLER = 0,
+  DGRAM_MACHINE
+} dgram_side_t;
+
+// Receiver statistics
+typedef struct {
+  uint64_t sent;        // packets sent
+  uint64_t received;    // in-order packets received
+  uint64_t lost;        // gaps in the sequence numbers (less late arrivals)
+  uint64_t reordered;   // late packets (discarded)
+  uint64_t duplicated;  // packets received twice (discarded)
+} dgram_stats_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// For DGRAM_UDP, addr is the host name/address and port the base port; for
+// DGRAM_UNIX, addr is the socket path prefix and port is ignored.
+// Returns NULL on failure
+dgram_link_t *dgram_link_open(dgram_family_t family, const char *addr, int port, dgram_side_t side);
+void dgram_link_close(dgram_link_t *l);
+
+// COMMUNICATIONS ==============================================================
+
+// Send a packet (the sequence number is assigned here). Never blocks.
+// Returns 0 on success
+int dgram_link_send(dgram_link_t *l, dgram_msg_t *msg);
+
+// Receive the next in-order packet. Never blocks. Returns 1 if a packet
+// was read, 0 if none is available
+int dgram_link_recv(dgram_link_t *l, dgram_msg_t *msg);
+
+// Like dgram_link_recv(), but waits up to timeout_ms milliseconds
+int dgram_link_wait(dgram_link_t *l, dgram_msg_t *msg, int timeout_ms);
+
+// GETTERS =====================================================================
+
+void dgram_link_stats(const dgram_link_t *l, dgram_stats_t *stats);
+
+// Socket, for polling
+int dgram_link_fd(const dgram_link_t *l);
+
+#endif // DGRAM_LINK_H
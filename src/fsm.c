@@ -7,32 +7,272 @@ gv_fsm version 0.3.2
 Generation date: 2022-05-20 09:51:35 +0200
 Generated from: src/fsm.dot
 The finite state machine has:
-  7 states
-  4 transition functions
+  9 states
+  6 transition functions
 Functions and types have been generated with prefix "ccnc_"
 ******************************************************************************/
 
 #include "fsm.h"
 #include "block.h"
 #include "point.h"
+#include "timeline.h"
 #include <unistd.h>
-#include <termios.h>
+#include <inttypes.h>
 
 // Install signal handler: 
 // SIGINT requests a transition to state stop
 #include <signal.h>
 static int _exit_request = 0;
+static int _interrupted = 0; // for the recorder: _exit_request is consumed
 static void signal_handler(int signal) {
   if (signal == SIGINT) {
     _exit_request = 1;
+    _interrupted = 1;
   }
 }
 
 // SEARCH FOR Your Code Here FOR CODE INSERTION POINTS!
 
+// trajectory records buffered between the tick and the CSV writer: at
+// tq = 5 ms, 40 s worth of samples
+#define LOG_RING 8192
+
+// log a trajectory sample (formatting happens in the logger thread)
+static void log_sample(ccnc_state_data_t *data, block_t *b, data_t lambda, data_t feed, point_t *sp) {
+  if (!trace_filter_pass(data->filter, block_n(b), machine_error(data->machine)))
+    return;
+  log_record_t rec = {
+    .n = block_n(b),
+    .t_tot = data->t_tot, .t_blk = data->t_blk,
+    .lambda = lambda, .s = lambda * block_length(b), .feed = feed,
+    .x = point_x(sp), .y = point_y(sp), .z = point_z(sp)
+  };
+  logger_push(data->log, &rec);
+}
+
+// store a step in the flight recorder
+static void record_step(ccnc_state_data_t *data, ccnc_state_t state, ccnc_state_t next, uint64_t t0, uint64_t t1) {
+  machine_t *m = data->machine;
+  block_t *b = data->prog ? program_current(data->prog) : NULL;
+  rec_entry_t e = {
+    .time = recorder_time(data->recorder, t0),
+    .duration = t1 - t0,
+    .state = state,
+    .next = next,
+    .block = b ? block_n(b) : 0,
+    .t_tot = data->t_tot
+  };
+  if (m) {
+    e.sp_x = point_x(machine_setpoint(m));
+    e.sp_y = point_y(machine_setpoint(m));
+    e.sp_z = point_z(machine_setpoint(m));
+    e.x = point_x(machine_position(m));
+    e.y = point_y(machine_position(m));
+    e.z = point_z(machine_position(m));
+    e.error = machine_error(m);
+  }
+  recorder_add(data->recorder, &e);
+}
+
+// Distance of the machine from the block target: the feedback includes the
+// workpiece offset, the target is in program coordinates
+static data_t target_dist(machine_t *m, block_t *b) {
+  point_t *pos = machine_position(m), *off = machine_offset(m), *t = block_target(b);
+  return sqrt(pow(point_x(pos) - point_x(off) - point_x(t), 2) +
+              pow(point_y(pos) - point_y(off) - point_y(t), 2) +
+              pow(point_z(pos) - point_z(off) - point_z(t), 2));
+}
+
+// Program listing, or just its summary (large programs)
+static void print_program(ccnc_state_data_t *data, program_t *p) {
+  if (data->print_program) program_print(p, stderr);
+  else program_summary(p, stderr);
+}
+
+// An interrupted job of the loaded program can be continued from its
+// checkpoint (until something else is run)
+static void offer_restart(ccnc_state_data_t *data) {
+  data->restart_offer = data->checkpoint && data->runs == 0 &&
+    checkpoint_last(data->checkpoint, &data->restart) &&
+    strcmp(data->restart.program, program_filename(data->prog)) == 0;
+}
+
+// Approach moves to the checkpointed setpoint, as an in-memory program:
+// straight up to the safe height (the tool may still be in the part), over
+// the setpoint, then down at the approach feedrate. The first block, with
+// no motion, sets the start point to the current setpoint: a first block
+// would otherwise start from the machine zero
+static program_t *approach_program(ccnc_state_data_t *data) {
+  checkpoint_state_t *st = &data->restart;
+  point_t *sp = machine_setpoint(data->machine);
+  data_t safe_z = checkpoint_safe_z(data->checkpoint);
+  char line[256];
+  program_t *p = program_new("approach");
+  if (!p) return NULL;
+  if (isnan(safe_z)) safe_z = point_z(machine_zero(data->machine));
+  safe_z = MAX(safe_z, MAX(st->z, point_z(sp)));
+  snprintf(line, sizeof(line), "N0 X%f Y%f Z%f", point_x(sp), point_y(sp), point_z(sp));
+  if (program_append(p, line, data->machine) == EXIT_FAILURE) goto fail;
+  snprintf(line, sizeof(line), "N1 G00 X%f Y%f Z%f", point_x(sp), point_y(sp), safe_z);
+  if (program_append(p, line, data->machine) == EXIT_FAILURE) goto fail;
+  snprintf(line, sizeof(line), "N2 G00 X%f Y%f Z%f", st->x, st->y, safe_z);
+  if (program_append(p, line, data->machine) == EXIT_FAILURE) goto fail;
+  // a feed move must not be empty
+  if (st->z < safe_z) {
+    snprintf(line, sizeof(line), "N3 G01 Z%f F%f", st->z, checkpoint_approach_feed(data->checkpoint));
+    if (program_append(p, line, data->machine) == EXIT_FAILURE) goto fail;
+  }
+  return p;
+fail:
+  program_free(p);
+  return NULL;
+}
+
+// Save the execution state, every few ticks of the motion states. The
+// approach moves of a restart are not saved: the checkpoint keeps the
+// interrupted job until it runs again
+static void checkpoint_step(ccnc_state_data_t *data, ccnc_state_t state) {
+  checkpoint_state_t st = {.active = 1, .state = state};
+  point_t *sp;
+  block_t *b;
+  data_t v;
+  switch (state) {
+    case CCNC_STATE_LOAD_BLOCK:
+    case CCNC_STATE_NO_MOTION:
+    case CCNC_STATE_RAPID_MOTION:
+    case CCNC_STATE_INTERP_MOTION:
+    case CCNC_STATE_FEED_HOLD:
+    case CCNC_STATE_HELD:
+      break;
+    default:
+      return;
+  }
+  if (data->restart_prog || !checkpoint_due(data->checkpoint)) return;
+  // at the end of the program, there is nothing to save
+  if (!(b = program_current(data->prog))) return;
+  strncpy(st.program, program_filename(data->prog), CHECKPOINT_PATHLEN - 1);
+  st.index = program_index(data->prog);
+  st.n = block_n(b);
+  st.t_tot = data->t_tot;
+  st.t_blk = data->t_blk;
+  // rapids restart from their beginning
+  if (block_type(b) != RAPID && block_type(b) != NO_MOTION)
+    st.lambda = block_lambda(b, data->t_blk, &v);
+  sp = machine_setpoint(data->machine);
+  st.x = point_x(sp);
+  st.y = point_y(sp);
+  st.z = point_z(sp);
+  st.override = data->override;
+  checkpoint_save(data->checkpoint, &st);
+}
+
+// Set the feed override from a percentage, absolute or relative to the
+// current one (with a sign), within the 10-200% range
+#define OVERRIDE_MIN 0.1
+#define OVERRIDE_MAX 2.0
+static void set_override(ccnc_state_data_t *data, const char *percent) {
+  char *end;
+  data_t v = strtod(percent, &end);
+  if (end == percent) {
+    eprintf("Invalid feed override: %s\n", percent);
+    return;
+  }
+  if (percent[0] == '+' || percent[0] == '-') v += data->override * 100;
+  data->override = MAX(OVERRIDE_MIN, MIN(OVERRIDE_MAX, v / 100.0));
+  eprintf("Feed override %.0f%%\n", data->override * 100);
+}
+
+// Process the next operator command, if any (one per tick: keys typed
+// ahead, like "rq", apply to successive states): start is served by the
+// idle state, quit by any state, programs are only loaded in idle
+static void read_commands(ccnc_state_data_t *data, int idle) {
+  command_t cmd;
+  program_t *p;
+  int panel = machine_override(data->machine);
+  // the knob on the machine panel acts when turned, like the keys
+  if (panel > 0 && panel != data->panel_override) {
+    data->panel_override = panel;
+    snprintf(cmd.arg, COMMAND_ARGLEN, "%d", panel);
+    set_override(data, cmd.arg);
+  }
+  if (!data->commands || !commands_poll(data->commands, idle, &cmd)) return;
+  switch (cmd.type) {
+  case CMD_START:
+    if (idle) data->start_request = 1;
+    else data->paused = data->hold = 0;
+    break;
+  case CMD_STOP:
+    data->quit_request = 1;
+    break;
+  case CMD_TOGGLE:
+    data->paused = !data->paused;
+    break;
+  case CMD_PAUSE:
+    data->paused = 1;
+    break;
+  case CMD_RESUME:
+    data->paused = data->hold = 0;
+    break;
+  case CMD_HOLD:
+    if (!idle) data->hold = 1;
+    break;
+  case CMD_FEED:
+    set_override(data, cmd.arg);
+    break;
+  case CMD_CONTINUE:
+    if (!idle) break;
+    if (data->restart_offer) data->continue_request = 1;
+    else eprintf("No interrupted job of %s to continue\n", program_filename(data->prog));
+    break;
+  case CMD_QUEUE:
+    if (!data->jobs && !(data->jobs = jobs_new(data->machine))) break;
+    if (!jobs_add(data->jobs, cmd.arg)) eprintf("Queued %s\n", cmd.arg);
+    break;
+  case CMD_LOAD:
+    if (!idle) {
+      eprintf("Cannot load %s while running\n", cmd.arg);
+      break;
+    }
+    // the current program is kept if the new one does not parse
+    if (!(p = program_new(cmd.arg))) break;
+    if (program_parse(p, data->machine) == EXIT_FAILURE) {
+      eprintf("Could not parse %s, keeping %s\n", cmd.arg, program_filename(data->prog));
+      program_free(p);
+      break;
+    }
+    program_free(data->prog);
+    data->prog = p;
+    eprintf("Loaded the program %s\n", program_filename(p));
+    print_program(data, p);
+    offer_restart(data);
+    data->prompted = 0;
+    break;
+  default:
+    break;
+  }
+  if (cmd.type == CMD_HOLD && !idle) {
+    eprintf("Feed hold\n");
+  }
+  else if (cmd.type == CMD_TOGGLE || cmd.type == CMD_PAUSE || cmd.type == CMD_RESUME ||
+      (cmd.type == CMD_START && !idle)) {
+    eprintf(data->paused ? "Pausing at the end of the block\n" : "Resuming\n");
+  }
+}
+
+// for the timeline
+static const char *transition_name(transition_func_t *f) {
+  if (f == ccnc_reset) return "reset";
+  if (f == ccnc_begin_rapid) return "begin_rapid";
+  if (f == ccnc_begin_interp) return "begin_interp";
+  if (f == ccnc_end_rapid) return "end_rapid";
+  if (f == ccnc_begin_hold) return "begin_hold";
+  if (f == ccnc_end_hold) return "end_hold";
+  return "transition";
+}
+
 // GLOBALS
 // State human-readable names
-const char *ccnc_state_names[] = {"init", "idle", "stop", "load_block", "no_motion", "rapid_motion", "interp_motion"};
+const char *ccnc_state_names[] = {"init", "idle", "stop", "load_block", "no_motion", "rapid_motion", "interp_motion", "feed_hold", "held"};
 
 // List of state functions
 state_func_t *const ccnc_state_table[CCNC_NUM_STATES] = {
@@ -43,18 +283,22 @@ state_func_t *const ccnc_state_table[CCNC_NUM_STATES] = {
   ccnc_do_no_motion,     // in state no_motion
   ccnc_do_rapid_motion,  // in state rapid_motion
   ccnc_do_interp_motion, // in state interp_motion
+  ccnc_do_feed_hold,     // in state feed_hold
+  ccnc_do_held,          // in state held
 };
 
 // Table of transition functions
 transition_func_t *const ccnc_transition_table[CCNC_NUM_STATES][CCNC_NUM_STATES] = {
-  /* states:           init             , idle             , stop             , load_block       , no_motion        , rapid_motion     , interp_motion     */
-  /* init          */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
-  /* idle          */ {NULL             , NULL             , NULL             , ccnc_reset       , NULL             , NULL             , NULL             }, 
-  /* stop          */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
-  /* load_block    */ {NULL             , NULL             , NULL             , NULL             , NULL             , ccnc_begin_rapid , ccnc_begin_interp}, 
-  /* no_motion     */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
-  /* rapid_motion  */ {NULL             , NULL             , NULL             , ccnc_end_rapid   , NULL             , NULL             , NULL             }, 
-  /* interp_motion */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* states:           init             , idle             , stop             , load_block       , no_motion        , rapid_motion     , interp_motion    , feed_hold        , held              */
+  /* init          */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* idle          */ {NULL             , NULL             , NULL             , ccnc_reset       , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* stop          */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* load_block    */ {NULL             , NULL             , NULL             , NULL             , NULL             , ccnc_begin_rapid , ccnc_begin_interp, NULL             , NULL             }, 
+  /* no_motion     */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* rapid_motion  */ {NULL             , NULL             , NULL             , ccnc_end_rapid   , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* interp_motion */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , ccnc_begin_hold  , NULL             }, 
+  /* feed_hold     */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , NULL             }, 
+  /* held          */ {NULL             , NULL             , NULL             , NULL             , NULL             , NULL             , ccnc_end_hold    , NULL             , NULL             }, 
 };
 
 //  ____  _        _       
@@ -75,49 +319,131 @@ transition_func_t *const ccnc_transition_table[CCNC_NUM_STATES][CCNC_NUM_STATES]
 ccnc_state_t ccnc_do_init(ccnc_state_data_t *data) {
   ccnc_state_t next_state = CCNC_STATE_IDLE;
   point_t *sp, *zero;
+  program_t *p;
+  int i;
+  // startup phases: config, setup, connect, wait for the parser, done
+  uint64_t t[5];
   signal(SIGINT, signal_handler); 
+  data->override = 1.0;
   
   // Steps:
   // * in case of errors, transition to stop
 
   // * print software version
   eprintf("C-CNC ver. %s, %s build\n", VERSION, BUILD_TYPE);
+  t[0] = now_ns();
   data->machine = machine_new(data->ini_file);
-  // * connect with the machine
+  if (!data->out) data->out = stdout;
   if (!data->machine) {
     next_state = CCNC_STATE_STOP;
     goto next_state;
   }
-  if (machine_connect(data->machine, NULL)) {
+  // * start parsing the G-code file on the job loader thread: it only
+  //   needs the machine configuration, and overlaps with what follows
+  //   (the broker connection above all)
+  if (!(data->jobs = jobs_new(data->machine)) || jobs_add(data->jobs, data->prog_file)) {
     next_state = CCNC_STATE_STOP;
     goto next_state;
   }
-
-  // * load and parse the G-code file
-  data->prog = program_new(data->prog_file);
-  if (!data->prog) {
+  t[1] = now_ns();
+  // * start the flight recorder, first thing: it has to see the faults
+  if (!(data->recorder = recorder_new(data->ini_file, machine_tq(data->machine), data->machine_id))) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  recorder_catch_crashes();
+  // * map the checkpoint file, if enabled (the only cost is then a NULL
+  //   check per step)
+  if (!(data->checkpoint = checkpoint_new(data->ini_file, data->machine_id))) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  if (!checkpoint_enabled(data->checkpoint)) {
+    checkpoint_free(data->checkpoint);
+    data->checkpoint = NULL;
+  }
+  // * take operator commands, unless running unattended
+  if (!data->autostart && !(data->commands = commands_new(data->ini_file, 1))) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  // * start the logger, on the binary trace if requested, with the
+  //   filters in the [TRACE] section
+  if (!(data->filter = trace_filter_new(data->ini_file))) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  if (data->trace_file && !(data->trace = trace_open(data->trace_file, 0,
+      trace_filter_columns(data->filter)))) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  if (!(data->log = logger_new(data->trace ? NULL : data->out, data->trace, LOG_RING))) {
     next_state = CCNC_STATE_STOP;
     goto next_state;
   }
-  if (program_parse(data->prog, data->machine) == EXIT_FAILURE) {
+  logger_set_columns(data->log, trace_filter_columns(data->filter));
+  if (data->machine_id && machine_set_id(data->machine, data->machine_id)) {
     next_state = CCNC_STATE_STOP;
     goto next_state;
   }
+  // * connect with the machine
+  t[2] = now_ns();
+  if (machine_connect(data->machine, NULL)) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  t[3] = now_ns();
+
+  // * collect the parsed G-code file
+  if (jobs_wait(data->jobs, &p) != JOBS_READY) {
+    next_state = CCNC_STATE_STOP;
+    goto next_state;
+  }
+  data->prog = p;
+  t[4] = now_ns();
   // if available, calculate here the look-ahead
 
-  // * print G-code file
+  // * print G-code file (a summary, unless print_program is set)
   eprintf("Parsed the program %s\n", data->prog_file);
-  program_print(data->prog, stderr);
+  print_program(data, p);
+  eprintf("Startup: config %.1f ms, setup %.1f ms, connect %.1f ms, "
+    "parse %.1f ms (overlapped), waiting for the parser %.1f ms, total %.1f ms\n",
+    (t[1] - t[0]) / 1E6, (t[2] - t[1]) / 1E6, (t[3] - t[2]) / 1E6,
+    jobs_parse_time(data->jobs) / 1E6, (t[4] - t[3]) / 1E6, (t[4] - t[0]) / 1E6);
+  timeline_span("init", "config", t[0], t[1], NULL, 0);
+  timeline_span("init", "setup", t[1], t[2], NULL, 0);
+  timeline_span("init", "connect", t[2], t[3], NULL, 0);
+  timeline_span("init", "wait_parser", t[3], t[4], NULL, 0);
+  offer_restart(data);
+  // * queue the next jobs, to be parsed in the background; without a
+  //   queue, the loader is not needed any more
+  for (i = 0; i < data->queue_len; i++) {
+    if (!jobs_add(data->jobs, data->queue[i])) eprintf("Queued %s\n", data->queue[i]);
+  }
+  if (data->queue_len == 0) {
+    jobs_free(data->jobs);
+    data->jobs = NULL;
+  }
 
+  // * hold the position: the machine zero, or where an interrupted job
+  //   left the tool (the approach moves of a restart start from there)
   sp = machine_setpoint(data->machine);
   zero = machine_zero(data->machine);
-  point_set_x(sp, point_x(zero));
-  point_set_y(sp, point_y(zero));
-  point_set_z(sp, point_z(zero));
+  if (data->restart_offer) {
+    point_set_xyz(sp, data->restart.x, data->restart.y, data->restart.z);
+  }
+  else {
+    point_set_x(sp, point_x(zero));
+    point_set_y(sp, point_y(zero));
+    point_set_z(sp, point_z(zero));
+  }
   machine_sync(data->machine, 1);
 
   
 next_state:
+  // init only goes to stop on errors
+  if (next_state == CCNC_STATE_STOP) data->fault = 1;
   switch (next_state) {
     case CCNC_STATE_IDLE:
     case CCNC_STATE_STOP:
@@ -135,37 +461,96 @@ next_state:
 // SIGINT triggers an emergency transition to stop
 ccnc_state_t ccnc_do_idle(ccnc_state_data_t *data) {
   ccnc_state_t next_state = CCNC_NO_CHANGE;
-  char key;
-  struct termios old_tio, new_tio;
+  machine_t *m = data->machine;
+  program_t *p;
   // Steps:
-  // if q is pressed, switch to stop
-  // * if spacebar is pressed, switch to load_block
+  // * at the end of the approach moves of a restart, continue the job
+  //   from the checkpointed block
+  // * at the end of a job, switch to the next queued one, if any
+  // * process commands, without blocking: the loop keeps ticking
+  // * on start, switch to load_block; on continue, run the approach
+  //   moves; on quit, switch to stop
   // * reset total timer
-  eprintf("Press spacebar or 'r' to run, 'q' to quit\n");
-  // save current terminal settings
-  tcgetattr(STDIN_FILENO, &old_tio);
-  // copy setting into new structure
-  new_tio = old_tio;
-  // disable caching 
-  cfmakeraw(&new_tio);
-  // set new settings
-  tcsetattr(STDIN_FILENO, TCSANOW, &new_tio);
-  // wait for keypress
-  key = getchar();
-  // reset initial temrinal setings
-  tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
-  switch (key)
-  {
-  case 'q':
-  case 'Q':
-    next_state = CCNC_STATE_STOP;
-    break;
-  case ' ':
-  case 'r':
+  if (data->restart_prog) {
+    program_free(data->prog);
+    data->prog = data->restart_prog;
+    data->restart_prog = NULL;
+    program_seek(data->prog, data->restart.index);
+    data->restart_lambda = data->restart.lambda;
+    data->restart_t_tot = data->restart.t_tot;
+    data->job_run = 1;
+    eprintf("Continuing %s from block N%" PRIu64 "\n", program_filename(data->prog),
+      data->restart.n);
     next_state = CCNC_STATE_LOAD_BLOCK;
-  default:
-    break;
+    goto end;
+  }
+  if ((data->job_run || data->autostart) && data->runs > 0 && data->jobs) {
+    switch (jobs_next(data->jobs, &p)) {
+    case JOBS_READY:
+      program_free(data->prog);
+      data->prog = p;
+      eprintf("Next job: %s (parsed in %.1f ms while running)\n",
+        program_filename(p), jobs_parse_time(data->jobs) / 1E6);
+      print_program(data, p);
+      next_state = CCNC_STATE_LOAD_BLOCK;
+      goto end;
+    case JOBS_LOADING:
+      // still parsing: keep ticking (the quit command still works)
+      read_commands(data, 1);
+      if (machine_rt_pacing(m) <= 0) usleep(machine_tq(m) * 1E6);
+      goto end;
+    default:
+      data->job_run = 0;
+      break;
+    }
+  }
+  if (data->autostart) {
+    // no operator: run once (and the queued jobs), then quit
+    next_state = data->runs > 0 ? CCNC_STATE_STOP : CCNC_STATE_LOAD_BLOCK;
+    goto end;
+  }
+  if (!data->prompted) {
+    eprintf("Press spacebar or 'r' to run (or resume), 'p' to pause, 'h' to hold, '+'/'-' for feed override, 'q' to quit\n");
+    if (data->restart_offer) {
+      eprintf("%s was interrupted at block N%" PRIu64 " (%.0f%% of it, t = %.3f s): press 'c' to continue from there\n",
+        data->restart.program, data->restart.n,
+        data->restart.lambda * 100, data->restart.t_tot);
+    }
+    data->prompted = 1;
   }
+  read_commands(data, 1);
+  if (data->continue_request) {
+    data->continue_request = 0;
+    if (!(p = approach_program(data))) {
+      eprintf("Could not plan the approach moves\n");
+      goto end;
+    }
+    data->restart_prog = data->prog;
+    data->prog = p;
+    data->restart_offer = 0;
+    data->paused = data->hold = 0;
+    data->prompted = 0;
+    if (data->restart.override >= OVERRIDE_MIN && data->restart.override <= OVERRIDE_MAX)
+      data->override = data->restart.override;
+    eprintf("Approaching [%.3f, %.3f, %.3f], feed override %.0f%%\n",
+      data->restart.x, data->restart.y, data->restart.z, data->override * 100);
+    next_state = CCNC_STATE_LOAD_BLOCK;
+  }
+  else if (data->start_request) {
+    data->start_request = 0;
+    data->paused = data->hold = 0;
+    data->prompted = 0;
+    data->restart_offer = 0;
+    data->job_run = 1;
+    // after a run, jobs queued in the meantime come first (next tick)
+    if (data->runs == 0 || !data->jobs || jobs_pending(data->jobs) == 0)
+      next_state = CCNC_STATE_LOAD_BLOCK;
+  }
+  // unpaced loop: do not spin while waiting for the operator
+  else if (machine_rt_pacing(m) <= 0) {
+    commands_wait(data->commands, machine_tq(m) * 1000);
+  }
+end:
   data->t_blk = 0;
   data->t_tot = 0;
   machine_listen_update(data->machine);
@@ -180,8 +565,8 @@ ccnc_state_t ccnc_do_idle(ccnc_state_data_t *data) {
       next_state = CCNC_NO_CHANGE;
   }
   
-  // SIGINT transition override
-  if (_exit_request) next_state = CCNC_STATE_STOP;
+  // SIGINT (and quit command) transition override
+  if (_exit_request || data->quit_request) next_state = CCNC_STATE_STOP;
   
   return next_state;
 }
@@ -197,6 +582,23 @@ ccnc_state_t ccnc_do_stop(ccnc_state_data_t *data) {
   // * free resources
   eprintf("Clean up...");
   signal(SIGINT, SIG_DFL);
+  // restores the terminal
+  if (data->commands) {
+    commands_free(data->commands);
+    data->commands = NULL;
+  }
+  // * dump the flight recorder; the stop step itself is not in it
+  if (data->recorder) {
+    rec_reason_t reason = _interrupted ? REC_SIGNAL : (data->fault ? REC_FAULT : REC_STOP);
+    if (recorder_enabled(data->recorder) && recorder_dump(data->recorder, reason, 0))
+      perror("Could not dump the flight recorder");
+    recorder_free(data->recorder);
+    data->recorder = NULL;
+  }
+  // waits for the loader thread
+  if (data->jobs) {
+    jobs_free(data->jobs);
+  }
   if (data->machine) {
     machine_disconnect(data->machine);
     machine_free(data->machine);
@@ -204,7 +606,29 @@ ccnc_state_t ccnc_do_stop(ccnc_state_data_t *data) {
   if (data->prog) {
     program_free(data->prog);
   }
+  // stopped during the approach moves of a restart
+  if (data->restart_prog) {
+    program_free(data->restart_prog);
+  }
+  // the checkpoint of an unfinished job stays in the file
+  if (data->checkpoint) {
+    checkpoint_free(data->checkpoint);
+    data->checkpoint = NULL;
+  }
+  // flushes what is left
+  if (data->log) {
+    logger_free(data->log);
+  }
+  if (data->trace) {
+    trace_close(data->trace);
+  }
   eprintf(" done.\n");
+  if (data->filter) {
+    if (trace_filter_logged(data->filter) < trace_filter_seen(data->filter) ||
+        trace_filter_triggers(data->filter) > 0)
+      trace_filter_print(data->filter, stderr);
+    trace_filter_free(data->filter);
+  }
   
   switch (next_state) {
     case CCNC_NO_CHANGE:
@@ -224,12 +648,16 @@ ccnc_state_t ccnc_do_load_block(ccnc_state_data_t *data) {
   
   // Steps:
   // * load next block/
+  // * at the end of a job, clear the checkpoint
   block_t *b = program_next(data->prog);
   if (!b) {
+    if (data->checkpoint && !data->restart_prog) checkpoint_done(data->checkpoint);
     next_state = CCNC_STATE_IDLE;
     goto next_state;
   }
   block_print(b, stderr);
+  // a restart within the block only applies to feed moves
+  if (block_type(b) == RAPID || block_type(b) == NO_MOTION) data->restart_lambda = 0;
   switch (block_type(b))
   {
   case NO_MOTION:
@@ -286,22 +714,50 @@ ccnc_state_t ccnc_do_no_motion(ccnc_state_data_t *data) {
 // SIGINT triggers an emergency transition to stop
 ccnc_state_t ccnc_do_rapid_motion(ccnc_state_data_t *data) {
   ccnc_state_t next_state = CCNC_NO_CHANGE;
-  data_t tq = machine_tq(data->machine);
+  machine_t *m = data->machine;
+  data_t tq = machine_tq(m);
+  data_t lambda, feed;
+  block_t *b = program_current(data->prog);
+  point_t *sp;
   // Steps:
   // * call machine_listen_update()
+  // * if interpolated, emit the next setpoint until the profile is over
   // * update times (block and total)
-  // * if error below threshold, transition to load_block
-  machine_listen_update(data->machine);
+  // * if in position, transition to load_block (unless paused)
+  machine_listen_update(m);
+  read_commands(data, 0);
+  if (machine_rapid_interp(m) && data->t_blk < block_dt(b) + tq / 2.0) {
+    if (machine_hold(m)) {
+      goto next_block;
+    }
+    data->t_blk += tq;
+    data->t_tot += tq;
+    if (data->t_blk < block_dt(b) + tq / 2.0) {
+      lambda = block_lambda(b, data->t_blk, &feed);
+      sp = block_interpolate(b, lambda);
+      log_sample(data, b, lambda, feed, sp);
+      machine_sync(m, 1);
+    }
+    goto next_block;
+  }
   data->t_blk += tq;
   data->t_tot += tq;
-  if (machine_error(data->machine) < machine_max_error(data->machine)) {
+  // feedback is only used for the in-position confirmation: when
+  // interpolating, the error alone may still refer to an earlier setpoint
+  if (machine_error(m) < machine_max_error(m) && (!machine_rapid_interp(m) ||
+      target_dist(m, b) < machine_max_error(m))) {
     next_state = CCNC_STATE_LOAD_BLOCK;
   }
   if (_exit_request) {
     _exit_request = 0;
     next_state = CCNC_STATE_LOAD_BLOCK;
   }
+  // paused, or feed hold (rapids are not replanned): hold the target
+  if ((data->paused || data->hold) && next_state == CCNC_STATE_LOAD_BLOCK) {
+    next_state = CCNC_NO_CHANGE;
+  }
 
+next_block:
   switch (next_state) {
     case CCNC_NO_CHANGE:
     case CCNC_STATE_LOAD_BLOCK:
@@ -311,15 +767,15 @@ ccnc_state_t ccnc_do_rapid_motion(ccnc_state_data_t *data) {
       next_state = CCNC_NO_CHANGE;
   }
   
-  // SIGINT transition override
-  if (_exit_request) next_state = CCNC_STATE_STOP;
+  // SIGINT (and quit command) transition override
+  if (_exit_request || data->quit_request) next_state = CCNC_STATE_STOP;
   
   return next_state;
 }
 
 
 // Function to be executed in state interp_motion
-// valid return states: CCNC_NO_CHANGE, CCNC_STATE_LOAD_BLOCK, CCNC_STATE_INTERP_MOTION
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_LOAD_BLOCK, CCNC_STATE_INTERP_MOTION, CCNC_STATE_FEED_HOLD
 // SIGINT triggers an emergency transition to stop
 ccnc_state_t ccnc_do_interp_motion(ccnc_state_data_t *data) {
   ccnc_state_t next_state = CCNC_NO_CHANGE;
@@ -329,10 +785,27 @@ ccnc_state_t ccnc_do_interp_motion(ccnc_state_data_t *data) {
   point_t *sp;
 
   // Steps:
+  // * hold while the machine cannot take setpoints
   // * calculate lambda
   // * interpolate position
   // * update times
   // * if lambda >= 1 transition to load_block
+  // * if paused, wait at the end of the block
+  // * if the feed override changed, replan
+  // * on feed hold, transition to feed_hold (after this setpoint)
+  read_commands(data, 0);
+  if (machine_hold(data->machine)) {
+    goto next_block;
+  }
+  if (data->paused && data->t_blk + tq >= block_dt(b) + tq / 2.0) {
+    machine_listen_update(data->machine);
+    goto next_block;
+  }
+  // feed override changed: replan the rest of the block from here
+  if (block_override(b) != data->override &&
+      !block_set_override(b, data->override)) {
+    block_replan(b, data->t_blk);
+  }
   data->t_blk += tq;
   data->t_tot += tq;
   if (data->t_blk >= block_dt(b) + tq / 2.0) {
@@ -345,26 +818,109 @@ ccnc_state_t ccnc_do_interp_motion(ccnc_state_data_t *data) {
     next_state = CCNC_STATE_LOAD_BLOCK;
     goto next_block;
   }
-  printf("%lu,%f,%f,%f,%f,%f,%f,%f,%f\n", block_n(b), data->t_tot, data->t_blk, lambda, lambda * block_length(b), feed, point_x(sp), point_y(sp), point_z(sp));
+  log_sample(data, b, lambda, feed, sp);
   machine_sync(data->machine, 0);
+  if (data->hold) {
+    next_state = CCNC_STATE_FEED_HOLD;
+  }
 
 next_block:
   switch (next_state) {
     case CCNC_NO_CHANGE:
     case CCNC_STATE_LOAD_BLOCK:
     case CCNC_STATE_INTERP_MOTION:
+    case CCNC_STATE_FEED_HOLD:
       break;
     default:
       next_state = CCNC_NO_CHANGE;
   }
   
-  // SIGINT transition override
-  if (_exit_request) next_state = CCNC_STATE_STOP;
+  // SIGINT (and quit command) transition override
+  if (_exit_request || data->quit_request) next_state = CCNC_STATE_STOP;
   
   return next_state;
 }
 
 
+
+// Function to be executed in state feed_hold
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_FEED_HOLD, CCNC_STATE_HELD
+// SIGINT triggers an emergency transition to stop
+ccnc_state_t ccnc_do_feed_hold(ccnc_state_data_t *data) {
+  ccnc_state_t next_state = CCNC_NO_CHANGE;
+  data_t tq = machine_tq(data->machine);
+  data_t lambda, feed;
+  block_t *b = program_current(data->prog);
+  point_t *sp;
+
+  // Steps:
+  // * follow the deceleration profile planned by ccnc_begin_hold(), which
+  //   ends at rest on the original path
+  // * at rest, transition to held (a resume is served there)
+  read_commands(data, 0);
+  if (machine_hold(data->machine)) {
+    goto next_state;
+  }
+  data->t_blk += tq;
+  data->t_tot += tq;
+  lambda = block_lambda(b, data->t_blk, &feed);
+  sp = block_interpolate(b, lambda);
+  if (sp) {
+    log_sample(data, b, lambda, feed, sp);
+    machine_sync(data->machine, 0);
+  }
+  if (!sp || data->t_blk + tq / 2.0 >= block_dt(b)) {
+    next_state = CCNC_STATE_HELD;
+  }
+
+next_state:
+  switch (next_state) {
+    case CCNC_NO_CHANGE:
+    case CCNC_STATE_FEED_HOLD:
+    case CCNC_STATE_HELD:
+      break;
+    default:
+      next_state = CCNC_NO_CHANGE;
+  }
+
+  // SIGINT (and quit command) transition override
+  if (_exit_request || data->quit_request) next_state = CCNC_STATE_STOP;
+
+  return next_state;
+}
+
+
+// Function to be executed in state held
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_HELD, CCNC_STATE_INTERP_MOTION
+// SIGINT triggers an emergency transition to stop
+ccnc_state_t ccnc_do_held(ccnc_state_data_t *data) {
+  ccnc_state_t next_state = CCNC_NO_CHANGE;
+
+  // Steps:
+  // * keep the setpoint, listening to the machine; times are frozen, like
+  //   when paused at the end of a block
+  // * on resume, transition to interp_motion (see ccnc_end_hold())
+  read_commands(data, 0);
+  machine_listen_update(data->machine);
+  if (!data->hold) {
+    next_state = CCNC_STATE_INTERP_MOTION;
+  }
+
+  switch (next_state) {
+    case CCNC_NO_CHANGE:
+    case CCNC_STATE_HELD:
+    case CCNC_STATE_INTERP_MOTION:
+      break;
+    default:
+      next_state = CCNC_NO_CHANGE;
+  }
+
+  // SIGINT (and quit command) transition override
+  if (_exit_request || data->quit_request) next_state = CCNC_STATE_STOP;
+
+  return next_state;
+}
+
 //  _____                    _ _   _              
 // |_   _| __ __ _ _ __  ___(_) |_(_) ___  _ __   
 //   | || '__/ _` | '_ \/ __| | __| |/ _ \| '_ \
@@ -382,9 +938,12 @@ next_block:
 // 1. from idle to load_block
 void ccnc_reset(ccnc_state_data_t *data) {
   // Steps:
-  // reset both timers
-  data->t_blk = data->t_tot = 0;
-  printf("n,t_tot,t_blk,lambda,s,feed,x,y,z\n");
+  // reset both timers (the total one continues, on a restart)
+  data->t_blk = 0;
+  data->t_tot = data->restart_t_tot;
+  data->restart_t_tot = 0;
+  data->runs++;
+  logger_header(data->log);
 }
 
 // This function is called in 1 transition:
@@ -395,10 +954,12 @@ void ccnc_begin_rapid(ccnc_state_data_t *data) {
   point_t *target = block_target(b);
   // Steps:
   // * reset block timer
-  // * set final position as set point and use machine_sync
+  // * set final position as set point and use machine_sync, unless the
+  //   rapid is interpolated (see ccnc_do_rapid_motion())
   // * call machine_listen_start()
   machine_listen_start(data->machine);
   data->t_blk = 0;
+  if (machine_rapid_interp(data->machine)) return;
   // copy target coordinates into setpoint
   point_set_x(sp, point_x(target));
   point_set_y(sp, point_y(target));
@@ -409,9 +970,19 @@ void ccnc_begin_rapid(ccnc_state_data_t *data) {
 // This function is called in 1 transition:
 // 1. from load_block to interp_motion
 void ccnc_begin_interp(ccnc_state_data_t *data) {
+  block_t *b = program_current(data->prog);
   // Steps:
-  // reset block timer
+  // * reset block timer
+  // * plan with the current feed override (this also drops the replanning
+  //   of a previous run, after a hold or an override)
+  // * on a restart, plan from rest at the checkpointed position
   data->t_blk = 0;
+  block_set_override(b, data->override);
+  block_replan(b, 0);
+  if (data->restart_lambda > 0) {
+    block_start_at(b, data->restart_lambda);
+    data->restart_lambda = 0;
+  }
 }
 
 // This function is called in 1 transition:
@@ -422,6 +993,26 @@ void ccnc_end_rapid(ccnc_state_data_t *data) {
   machine_listen_stop(data->machine);
 }
 
+// This function is called in 1 transition:
+// 1. from interp_motion to feed_hold
+void ccnc_begin_hold(ccnc_state_data_t *data) {
+  block_t *b = program_current(data->prog);
+  // Steps:
+  // * replan the block from the last setpoint into a stop
+  block_hold(b, data->t_blk);
+}
+
+// This function is called in 1 transition:
+// 1. from held to interp_motion
+void ccnc_end_hold(ccnc_state_data_t *data) {
+  block_t *b = program_current(data->prog);
+  // Steps:
+  // * replan the rest of the block from the held position, with the
+  //   current feed override
+  block_set_override(b, data->override);
+  block_resume(b, data->t_blk);
+}
+
 
 //  ____  _        _        
 // / ___|| |_ __ _| |_ ___  
@@ -437,11 +1028,40 @@ void ccnc_end_rapid(ccnc_state_data_t *data) {
 //                              |___/           
 
 ccnc_state_t ccnc_run_state(ccnc_state_t cur_state, ccnc_state_data_t *data) {
+  // instrumentation costs a NULL check when disabled
+  fsm_timing_t *timing = data ? data->timing : NULL;
+  int record = data && data->recorder;
+  int tl = timeline_enabled();
+  int timed = timing || record || tl;
+  uint64_t t0 = timed ? now_ns() : 0, t1 = 0, t2 = 0;
+  // a step is a tick
+  if (data && data->machine) machine_tick(data->machine);
   ccnc_state_t new_state = ccnc_state_table[cur_state](data);
   if (new_state == CCNC_NO_CHANGE) new_state = cur_state;
   transition_func_t *transition = ccnc_transition_table[cur_state][new_state];
+  if (timed) t1 = now_ns();
   if (transition)
     transition(data);
+  if (timed) t2 = transition ? now_ns() : t1;
+  if (tl) {
+    // the stop state frees the program
+    block_t *b = (data && data->prog && cur_state != CCNC_STATE_STOP) ?
+      program_current(data->prog) : NULL;
+    timeline_span("state", ccnc_state_names[cur_state], t0, t1, "block", b ? block_n(b) : 0);
+    if (transition) timeline_span("transition", transition_name(transition), t1, t2, NULL, 0);
+  }
+  if (timing) {
+    fsm_timing_state(timing, cur_state, t1 - t0);
+    if (transition) fsm_timing_transition(timing, cur_state, new_state, t2 - t1);
+    fsm_timing_step(timing, cur_state, t2 - t0);
+  }
+  // the stop state dumps and frees the recorder
+  if (record && data->recorder) {
+    record_step(data, cur_state, new_state, t0, t2);
+  }
+  if (data && data->checkpoint && cur_state != CCNC_STATE_STOP) {
+    checkpoint_step(data, cur_state);
+  }
   return new_state == CCNC_NO_CHANGE ? cur_state : new_state;
 };
 
@@ -16,6 +16,13 @@ Functions and types have been generated with prefix "ccnc_"
 #define FSM_H
 #include "machine.h"
 #include "program.h"
+#include "fsm_timing.h"
+#include "logger.h"
+#include "trace_filter.h"
+#include "recorder.h"
+#include "commands.h"
+#include "jobs.h"
+#include "checkpoint.h"
 #include "defines.h"
 #include <stdlib.h>
 
@@ -29,6 +36,37 @@ typedef struct {
   program_t *prog;    // program object
   data_t t_tot;       // total program timer
   data_t t_blk;       // block timer
+  const char *machine_id; // if set, tags the machine topics (many machines)
+  int autostart;      // run the program without waiting for a key, then stop
+  int runs;           // number of times the program was started
+  int print_program;  // list the programs on load (default: a summary)
+  FILE *out;          // CSV output (stdout if NULL)
+  const char *trace_file; // if set, binary trace instead of the CSV output
+  trace_t *trace;
+  logger_t *log;      // writes out, off the realtime tick
+  trace_filter_t *filter; // which samples and columns get logged
+  fsm_timing_t *timing; // if set, ccnc_run_state() times every step
+  recorder_t *recorder; // black box of the last steps, dumped on stop
+  int fault;          // init failed (e.g. program parsing error)
+  commands_t *commands; // operator input (not with autostart)
+  int start_request;  // start command received
+  int quit_request;   // quit command received
+  int paused;         // stop at the end of the current block
+  int hold;           // feed hold: stop now, along the path
+  data_t override;    // feed override factor (0.1 to 2)
+  int panel_override; // last override (%) seen from the machine panel
+  char const **queue; // G-code files to run after prog_file, back to back
+  int queue_len;
+  jobs_t *jobs;       // job queue (parses the next program while running)
+  int job_run;        // running the queued jobs
+  int prompted;       // idle prompt printed
+  checkpoint_t *checkpoint; // execution state, for crash recovery (if set)
+  checkpoint_state_t restart; // interrupted job found at startup
+  int restart_offer;  // restart is a job of the loaded program
+  int continue_request; // continue command received
+  program_t *restart_prog; // the job to continue, during the approach moves
+  data_t restart_lambda; // where the first block restarts (0: at its start)
+  data_t restart_t_tot; // total timer at the checkpoint
 } ccnc_state_data_t;
 
 // NOTHING SHALL BE CHANGED AFTER THIS LINE!
@@ -42,6 +80,8 @@ typedef enum {
   CCNC_STATE_NO_MOTION,  
   CCNC_STATE_RAPID_MOTION,  
   CCNC_STATE_INTERP_MOTION,  
+  CCNC_STATE_FEED_HOLD,  
+  CCNC_STATE_HELD,  
   CCNC_NUM_STATES,
   CCNC_NO_CHANGE
 } ccnc_state_t;
@@ -80,9 +120,17 @@ ccnc_state_t ccnc_do_no_motion(ccnc_state_data_t *data);
 ccnc_state_t ccnc_do_rapid_motion(ccnc_state_data_t *data);
 
 // Function to be executed in state interp_motion
-// valid return states: CCNC_NO_CHANGE, CCNC_STATE_LOAD_BLOCK, CCNC_STATE_INTERP_MOTION
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_LOAD_BLOCK, CCNC_STATE_INTERP_MOTION, CCNC_STATE_FEED_HOLD
 ccnc_state_t ccnc_do_interp_motion(ccnc_state_data_t *data);
 
+// Function to be executed in state feed_hold
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_FEED_HOLD, CCNC_STATE_HELD
+ccnc_state_t ccnc_do_feed_hold(ccnc_state_data_t *data);
+
+// Function to be executed in state held
+// valid return states: CCNC_NO_CHANGE, CCNC_STATE_HELD, CCNC_STATE_INTERP_MOTION
+ccnc_state_t ccnc_do_held(ccnc_state_data_t *data);
+
 
 // List of state functions
 extern state_func_t *const ccnc_state_table[CCNC_NUM_STATES];
@@ -93,6 +141,8 @@ void ccnc_reset(ccnc_state_data_t *data);
 void ccnc_begin_rapid(ccnc_state_data_t *data);
 void ccnc_begin_interp(ccnc_state_data_t *data);
 void ccnc_end_rapid(ccnc_state_data_t *data);
+void ccnc_begin_hold(ccnc_state_data_t *data);
+void ccnc_end_hold(ccnc_state_data_t *data);
 
 // Table of transition functions
 extern transition_func_t *const ccnc_transition_table[CCNC_NUM_STATES][CCNC_NUM_STATES];
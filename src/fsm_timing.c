@@ -0,0 +1,195 @@
+//   _____ ____  __  __   _   _           _
+//  |  ___/ ___||  \/  | | |_(_)_ __ ___ (_)_ __   __ _
+//  | |_  \___ \| |\/| | | __| | '_ ` _ \| | '_ \ / _` |
+//  |  _|  ___) | |  | | | |_| | | | | | | | | | | (_| |
+//  |_|   |____/|_|  |_|  \__|_|_| |_| |_|_|_| |_|\__, |
+//                                                |___/
+//
+
+#include "fsm_timing.h"
+#include <inttypes.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// FSM timing object structure
+typedef struct fsm_timing {
+  size_t n;                  // number of states
+  const char **names;
+  uint64_t budget;           // ns, 0 for none
+  histogram_t **state;       // n histograms
+  histogram_t **transition;  // n x n, NULL if not tracked
+  histogram_t *step;
+  uint64_t *overruns;        // per state
+} fsm_timing_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+fsm_timing_t *fsm_timing_new(size_t n_states, const char **names) {
+  assert(names);
+  size_t i;
+  fsm_timing_t *t = (fsm_timing_t *)calloc(1, sizeof(fsm_timing_t));
+  if (!t) {
+    perror("Could not allocate FSM timing");
+    return NULL;
+  }
+  t->n = n_states;
+  t->names = names;
+  t->state = (histogram_t **)calloc(n_states, sizeof(histogram_t *));
+  t->transition = (histogram_t **)calloc(n_states * n_states, sizeof(histogram_t *));
+  t->overruns = (uint64_t *)calloc(n_states, sizeof(uint64_t));
+  t->step = histogram_new();
+  if (!t->state || !t->transition || !t->overruns || !t->step) {
+    perror("Could not allocate FSM timing");
+    fsm_timing_free(t);
+    return NULL;
+  }
+  for (i = 0; i < n_states; i++) {
+    if (!(t->state[i] = histogram_new())) {
+      fsm_timing_free(t);
+      return NULL;
+    }
+  }
+  return t;
+}
+
+void fsm_timing_free(fsm_timing_t *t) {
+  assert(t);
+  size_t i;
+  for (i = 0; t->state && i < t->n; i++) {
+    if (t->state[i]) histogram_free(t->state[i]);
+  }
+  for (i = 0; t->transition && i < t->n * t->n; i++) {
+    if (t->transition[i]) histogram_free(t->transition[i]);
+  }
+  if (t->step) histogram_free(t->step);
+  free(t->state);
+  free(t->transition);
+  free(t->overruns);
+  free(t);
+  t = NULL;
+}
+
+int fsm_timing_track(fsm_timing_t *t, size_t from, size_t to) {
+  assert(t && from < t->n && to < t->n);
+  histogram_t **h = &t->transition[from * t->n + to];
+  if (!*h) *h = histogram_new();
+  return *h ? 0 : 1;
+}
+
+void fsm_timing_set_budget(fsm_timing_t *t, uint64_t budget) {
+  assert(t);
+  t->budget = budget;
+}
+
+void fsm_timing_reset(fsm_timing_t *t) {
+  assert(t);
+  size_t i;
+  for (i = 0; i < t->n; i++) {
+    histogram_reset(t->state[i]);
+    t->overruns[i] = 0;
+  }
+  for (i = 0; i < t->n * t->n; i++) {
+    if (t->transition[i]) histogram_reset(t->transition[i]);
+  }
+  histogram_reset(t->step);
+}
+
+
+// RECORDING ===================================================================
+
+void fsm_timing_state(fsm_timing_t *t, size_t state, uint64_t ns) {
+  assert(t && state < t->n);
+  histogram_add(t->state[state], ns);
+}
+
+void fsm_timing_transition(fsm_timing_t *t, size_t from, size_t to, uint64_t ns) {
+  assert(t && from < t->n && to < t->n);
+  histogram_t *h = t->transition[from * t->n + to];
+  if (h) histogram_add(h, ns);
+}
+
+void fsm_timing_step(fsm_timing_t *t, size_t state, uint64_t ns) {
+  assert(t && state < t->n);
+  histogram_add(t->step, ns);
+  if (t->budget > 0 && ns > t->budget) t->overruns[state]++;
+}
+
+
+// REPORTING ===================================================================
+
+void fsm_timing_print(const fsm_timing_t *t, FILE *out) {
+  assert(t && out);
+  char name[128];
+  size_t i, j;
+  const histogram_t *h;
+  fprintf(out, "FSM timing, budget %.1f us per step, %" PRIu64 " overruns\n",
+    t->budget / 1E3, fsm_timing_overruns(t));
+  for (i = 0; i < t->n; i++) {
+    if (histogram_count(t->state[i]) == 0) continue;
+    if (t->overruns[i] > 0) {
+      snprintf(name, sizeof(name), "  %s (%" PRIu64 " overruns)", t->names[i], t->overruns[i]);
+    }
+    else {
+      snprintf(name, sizeof(name), "  %s", t->names[i]);
+    }
+    histogram_print(t->state[i], out, name, 1E3, "us");
+  }
+  for (i = 0; i < t->n; i++) {
+    for (j = 0; j < t->n; j++) {
+      h = t->transition[i * t->n + j];
+      if (!h || histogram_count(h) == 0) continue;
+      snprintf(name, sizeof(name), "  %s->%s", t->names[i], t->names[j]);
+      histogram_print(h, out, name, 1E3, "us");
+    }
+  }
+  histogram_print(t->step, out, "  step", 1E3, "us");
+}
+
+
+// GETTERS =====================================================================
+
+uint64_t fsm_timing_budget(const fsm_timing_t *t) {
+  assert(t);
+  return t->budget;
+}
+
+uint64_t fsm_timing_overruns(const fsm_timing_t *t) {
+  assert(t);
+  uint64_t sum = 0;
+  size_t i;
+  for (i = 0; i < t->n; i++) {
+    sum += t->overruns[i];
+  }
+  return sum;
+}
+
+uint64_t fsm_timing_state_overruns(const fsm_timing_t *t, size_t state) {
+  assert(t && state < t->n);
+  return t->overruns[state];
+}
+
+const histogram_t *fsm_timing_state_hist(const fsm_timing_t *t, size_t state) {
+  assert(t && state < t->n);
+  return t->state[state];
+}
+
+const histogram_t *fsm_timing_transition_hist(const fsm_timing_t *t, size_t from, size_t to) {
+  assert(t && from < t->n && to < t->n);
+  return t->transition[from * t->n + to];
+}
+
+const histogram_t *fsm_timing_step_hist(const fsm_timing_t *t) {
+  assert(t);
+  return t->step;
+}
@@ -0,0 +1,83 @@
+//   _____ ____  __  __   _   _           _
+//  |  ___/ ___||  \/  | | |_(_)_ __ ___ (_)_ __   __ _
+//  | |_  \___ \| |\/| | | __| | '_ ` _ \| | '_ \ / _` |
+//  |  _|  ___) | |  | | | |_| | | | | | | | | | | (_| |
+//  |_|   |____/|_|  |_|  \__|_|_| |_| |_|_|_| |_|\__, |
+//                                                |___/
+//  FSM timing class
+//  Execution time of every state function and transition function run by
+//  a state manager (see ccnc_run_state()), and of the whole FSM step: a
+//  step that takes longer than the tick budget (tq / rt_pacing) is an
+//  overrun, charged to the state that was running. Times go into
+//  histograms, so recording never allocates.
+
+#ifndef FSM_TIMING_H
+#define FSM_TIMING_H
+
+#include "defines.h"
+#include "histogram.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct fsm_timing fsm_timing_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// names must outlive the object (e.g. ccnc_state_names). Returns NULL on
+// failure
+fsm_timing_t *fsm_timing_new(size_t n_states, const char **names);
+void fsm_timing_free(fsm_timing_t *t);
+
+// Allocate the histogram for the transition from -> to; transitions that
+// are not tracked are not recorded. Returns 0 on success
+int fsm_timing_track(fsm_timing_t *t, size_t from, size_t to);
+
+// Tick budget (ns); 0 (the default) disables overrun detection
+void fsm_timing_set_budget(fsm_timing_t *t, uint64_t budget);
+
+// Forget all samples
+void fsm_timing_reset(fsm_timing_t *t);
+
+// RECORDING ===================================================================
+
+void fsm_timing_state(fsm_timing_t *t, size_t state, uint64_t ns);
+void fsm_timing_transition(fsm_timing_t *t, size_t from, size_t to, uint64_t ns);
+
+// Whole FSM step (state plus transition) started in state
+void fsm_timing_step(fsm_timing_t *t, size_t state, uint64_t ns);
+
+// REPORTING ===================================================================
+
+// One line per state, per tracked transition and for the whole step, with
+// overruns (us)
+void fsm_timing_print(const fsm_timing_t *t, FILE *out);
+
+// GETTERS =====================================================================
+
+uint64_t fsm_timing_budget(const fsm_timing_t *t);
+
+// total overruns, or those of a state
+uint64_t fsm_timing_overruns(const fsm_timing_t *t);
+uint64_t fsm_timing_state_overruns(const fsm_timing_t *t, size_t state);
+
+const histogram_t *fsm_timing_state_hist(const fsm_timing_t *t, size_t state);
+
+// NULL if the transition is not tracked
+const histogram_t *fsm_timing_transition_hist(const fsm_timing_t *t, size_t from, size_t to);
+
+const histogram_t *fsm_timing_step_hist(const fsm_timing_t *t);
+
+#endif // FSM_TIMING_H
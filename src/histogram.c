@@ -0,0 +1,187 @@
+//   _   _ _     _
+//  | | | (_)___| |_ ___   __ _ _ __ __ _ _ __ ___
+//  | |_| | / __| __/ _ \ / _` | '__/ _` | '_ ` _ \
+//  |  _  | \__ \ || (_) | (_| | | | (_| | | | | | |
+//  |_| |_|_|___/\__\___/ \__, |_|  \__,_|_| |_| |_|
+//                        |___/
+
+#include "histogram.h"
+#include <inttypes.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define SUB_BITS 7
+#define SUB_COUNT (1 << SUB_BITS)
+#define HALF_COUNT (SUB_COUNT / 2)
+// values < SUB_COUNT map 1:1, then 64 buckets for each of the remaining
+// 64 - SUB_BITS + 1 powers of two
+#define N_BUCKETS (SUB_COUNT + (64 - SUB_BITS) * HALF_COUNT)
+
+// Histogram object structure
+typedef struct histogram {
+  uint64_t count;            // number of samples
+  uint64_t min, max;         // exact extremes
+  data_t sum;                // for the mean
+  uint64_t buckets[N_BUCKETS];
+} histogram_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static size_t bucket_index(uint64_t v);
+static uint64_t bucket_value(size_t i);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+histogram_t *histogram_new() {
+  histogram_t *h = (histogram_t *)calloc(1, sizeof(histogram_t));
+  if (!h) {
+    perror("Could not allocate histogram");
+    return NULL;
+  }
+  histogram_reset(h);
+  return h;
+}
+
+void histogram_free(histogram_t *h) {
+  assert(h);
+  free(h);
+  h = NULL;
+}
+
+void histogram_reset(histogram_t *h) {
+  assert(h);
+  memset(h, 0, sizeof(histogram_t));
+  h->min = UINT64_MAX;
+}
+
+void histogram_print(const histogram_t *h, FILE *out, const char *name, data_t scale, const char *unit) {
+  assert(h && out && name && unit);
+  if (h->count == 0) {
+    fprintf(out, "%s: no samples\n", name);
+    return;
+  }
+  fprintf(out, "%s: n=%" PRIu64 " min=%.1f mean=%.1f p50=%.1f p99=%.1f p99.9=%.1f max=%.1f%s%s\n",
+    name, h->count, h->min / scale, histogram_mean(h) / scale,
+    histogram_percentile(h, 50) / scale, histogram_percentile(h, 99) / scale,
+    histogram_percentile(h, 99.9) / scale, h->max / scale, *unit ? " " : "", unit);
+}
+
+
+// RECORDING ===================================================================
+
+void histogram_add(histogram_t *h, uint64_t value) {
+  assert(h);
+  h->buckets[bucket_index(value)]++;
+  h->count++;
+  h->sum += value;
+  if (value < h->min) h->min = value;
+  if (value > h->max) h->max = value;
+}
+
+void histogram_merge(histogram_t *h, const histogram_t *src) {
+  assert(h && src);
+  size_t i;
+  for (i = 0; i < N_BUCKETS; i++) {
+    h->buckets[i] += src->buckets[i];
+  }
+  h->count += src->count;
+  h->sum += src->sum;
+  if (src->min < h->min) h->min = src->min;
+  if (src->max > h->max) h->max = src->max;
+}
+
+
+// GETTERS =====================================================================
+
+uint64_t histogram_percentile(const histogram_t *h, data_t percent) {
+  assert(h);
+  uint64_t target, seen = 0;
+  size_t i;
+  if (h->count == 0) return 0;
+  target = (uint64_t)ceil(percent / 100.0 * h->count);
+  if (target < 1) target = 1;
+  for (i = 0; i < N_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= target) {
+      // never report more than what was actually seen
+      return MIN(bucket_value(i), h->max);
+    }
+  }
+  return h->max;
+}
+
+data_t histogram_mean(const histogram_t *h) {
+  assert(h);
+  return h->count ? h->sum / h->count : 0;
+}
+
+uint64_t histogram_min(const histogram_t *h) {
+  assert(h);
+  return h->count ? h->min : 0;
+}
+
+#define histogram_getter(typ, par, name) \
+typ histogram_##name(const histogram_t *h) { assert(h); return h->par; }
+
+histogram_getter(uint64_t, count, count);
+histogram_getter(uint64_t, max, max);
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Index of the bucket holding v: for v >= SUB_COUNT, the top SUB_BITS bits
+// of v select one of the HALF_COUNT buckets of its power of two
+static size_t bucket_index(uint64_t v) {
+  int msb, shift;
+  if (v < SUB_COUNT) return v;
+  msb = 63 - __builtin_clzll(v);
+  shift = msb - SUB_BITS + 1;
+  return SUB_COUNT + (shift - 1) * HALF_COUNT + ((v >> shift) - HALF_COUNT);
+}
+
+// Highest value that falls into the bucket i
+static uint64_t bucket_value(size_t i) {
+  size_t shift, sub;
+  if (i < SUB_COUNT) return i;
+  shift = (i - SUB_COUNT) / HALF_COUNT + 1;
+  sub = (i - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+  return ((uint64_t)(sub + 1) << shift) - 1;
+}
+
+
+
+//   _____ _____ ____ _____   __  __       _
+//  |_   _| ____/ ___|_   _| |  \/  | __ _(_)_ __
+//    | | |  _| \___ \ | |   | |\/| |/ _` | | '_ \
+//    | | | |___ ___) || |   | |  | | (_| | | | | |
+//    |_| |_____|____/ |_|   |_|  |_|\__,_|_|_| |_|
+// Only needed for testing purpose. To enable, compile as:
+// clang src/histogram.c src/utils.c -o histogram -lm -DHISTOGRAM_MAIN
+#ifdef HISTOGRAM_MAIN
+int main() {
+  histogram_t *h = histogram_new();
+  uint64_t i;
+  for (i = 1; i <= 1000000; i++) {
+    histogram_add(h, i);
+  }
+  // expect p50 ~ 500000, p99 ~ 990000, within 1.6%
+  histogram_print(h, stdout, "uniform 1..1e6", 1, "");
+  histogram_free(h);
+  return 0;
+}
+#endif
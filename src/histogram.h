@@ -0,0 +1,63 @@
+//   _   _ _     _
+//  | | | (_)___| |_ ___   __ _ _ __ __ _ _ __ ___
+//  | |_| | / __| __/ _ \ / _` | '__/ _` | '_ ` _ \
+//  |  _  | \__ \ || (_) | (_| | | | (_| | | | | | |
+//  |_| |_|_|___/\__\___/ \__, |_|  \__,_|_| |_| |_|
+//                        |___/
+//  Histogram class
+//  HDR-style log-linear histogram of unsigned integer values (typically
+//  nanoseconds): values below 128 are exact, above that each power of two
+//  is split into 64 buckets, so the relative error is below 1.6% over the
+//  whole 64 bit range. Adding a value is O(1) and never allocates, so it
+//  can be used within the realtime tick.
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct histogram histogram_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+histogram_t *histogram_new();
+void histogram_free(histogram_t *h);
+void histogram_reset(histogram_t *h);
+
+// Print a one-line summary: count, min, mean, p50, p99, p99.9 and max.
+// Values are divided by scale (e.g. 1E3 for ns to us) and tagged by unit
+void histogram_print(const histogram_t *h, FILE *out, const char *name, data_t scale, const char *unit);
+
+// RECORDING ===================================================================
+
+void histogram_add(histogram_t *h, uint64_t value);
+
+// Add all the counts of src into h
+void histogram_merge(histogram_t *h, const histogram_t *src);
+
+// GETTERS =====================================================================
+
+uint64_t histogram_count(const histogram_t *h);
+uint64_t histogram_min(const histogram_t *h);
+uint64_t histogram_max(const histogram_t *h);
+data_t histogram_mean(const histogram_t *h);
+
+// Value below which the given percentage (0-100) of samples falls
+uint64_t histogram_percentile(const histogram_t *h, data_t percent);
+
+#endif // HISTOGRAM_H
@@ -50,5 +50,6 @@ int ini_get_char(void *ini_p, const char *section, const char *field, char *val,
   inipp::Ini<char> *ini = static_cast<inipp::Ini<char> *>(ini_p);
   bool r = inipp::extract(ini->sections[section][field], str);
   strncpy(val, str.c_str(), len);
-  return r ? 0 : 1;
+  // extraction into a string never fails: a missing field reads as empty
+  return (r && !str.empty()) ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,253 @@
+//       _       _
+//      | | ___ | |__  ___
+//   _  | |/ _ \| '_ \/ __|
+//  | |_| | (_) | |_) \__ \
+//   \___/ \___/|_.__/|___/
+//
+
+#include "jobs.h"
+#include "rt.h"
+#include <pthread.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// programs parsed ahead of the running one: each is a whole program in
+// memory, and the queue may change before it is needed
+#define JOBS_AHEAD 1
+
+typedef enum {
+  JOB_QUEUED = 0,
+  JOB_PARSING,
+  JOB_READY,
+  JOB_FAILED
+} job_state_t;
+
+// A queued file
+typedef struct job {
+  char *filename;
+  program_t *prog;           // parsed program (JOB_READY)
+  job_state_t state;
+  uint64_t parse_ns;         // parsing time
+  struct job *next;
+} job_t;
+
+// Job queue object structure
+typedef struct jobs {
+  machine_t *machine;
+  job_t *head, *tail;
+  size_t pending;
+  int running;
+  uint64_t parse_ns;         // parsing time of the last program taken
+  pthread_mutex_t lock;      // protects everything above
+  pthread_cond_t wake;       // loader: a job was added or taken
+  pthread_cond_t parsed;     // jobs_wait(): a job was parsed
+  pthread_t loader;
+} jobs_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static void *loader_run(void *arg);
+static jobs_status_t take(jobs_t *j, program_t **p, int wait);
+static job_t *next_to_parse(jobs_t *j);
+static void job_free(job_t *job);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+jobs_t *jobs_new(machine_t *m) {
+  assert(m);
+  jobs_t *j = (jobs_t *)calloc(1, sizeof(jobs_t));
+  if (!j) {
+    perror("Could not allocate job queue");
+    return NULL;
+  }
+  j->machine = m;
+  j->running = 1;
+  pthread_mutex_init(&j->lock, NULL);
+  pthread_cond_init(&j->wake, NULL);
+  pthread_cond_init(&j->parsed, NULL);
+  if (rt_thread_create(&j->loader, loader_run, j)) {
+    perror("Could not start job loader thread");
+    pthread_cond_destroy(&j->parsed);
+    pthread_cond_destroy(&j->wake);
+    pthread_mutex_destroy(&j->lock);
+    free(j);
+    return NULL;
+  }
+  return j;
+}
+
+void jobs_free(jobs_t *j) {
+  assert(j);
+  job_t *job, *next;
+  pthread_mutex_lock(&j->lock);
+  j->running = 0;
+  pthread_cond_signal(&j->wake);
+  pthread_mutex_unlock(&j->lock);
+  pthread_join(j->loader, NULL);
+  if (j->pending > 0) {
+    eprintf("Job queue: %zu jobs not run\n", j->pending);
+  }
+  for (job = j->head; job; job = next) {
+    next = job->next;
+    job_free(job);
+  }
+  pthread_cond_destroy(&j->parsed);
+  pthread_cond_destroy(&j->wake);
+  pthread_mutex_destroy(&j->lock);
+  free(j);
+  j = NULL;
+}
+
+
+// QUEUE =======================================================================
+
+int jobs_add(jobs_t *j, const char *filename) {
+  assert(j && filename);
+  job_t *job = (job_t *)calloc(1, sizeof(job_t));
+  if (!job || !(job->filename = strdup(filename))) {
+    perror("Could not allocate job");
+    free(job);
+    return 1;
+  }
+  pthread_mutex_lock(&j->lock);
+  if (j->tail) j->tail->next = job;
+  else j->head = job;
+  j->tail = job;
+  j->pending++;
+  pthread_cond_signal(&j->wake);
+  pthread_mutex_unlock(&j->lock);
+  return 0;
+}
+
+jobs_status_t jobs_next(jobs_t *j, program_t **p) {
+  assert(j && p);
+  return take(j, p, 0);
+}
+
+jobs_status_t jobs_wait(jobs_t *j, program_t **p) {
+  assert(j && p);
+  return take(j, p, 1);
+}
+
+
+// GETTERS =====================================================================
+
+uint64_t jobs_parse_time(jobs_t *j) {
+  assert(j);
+  uint64_t t;
+  pthread_mutex_lock(&j->lock);
+  t = j->parse_ns;
+  pthread_mutex_unlock(&j->lock);
+  return t;
+}
+
+size_t jobs_pending(jobs_t *j) {
+  assert(j);
+  size_t n;
+  pthread_mutex_lock(&j->lock);
+  n = j->pending;
+  pthread_mutex_unlock(&j->lock);
+  return n;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Parse the queued programs, JOBS_AHEAD at a time; parsing happens
+// outside the lock
+static void *loader_run(void *arg) {
+  jobs_t *j = (jobs_t *)arg;
+  job_t *job;
+  program_t *p;
+  uint64_t t0;
+  int ok;
+  pthread_mutex_lock(&j->lock);
+  while (j->running) {
+    if (!(job = next_to_parse(j))) {
+      pthread_cond_wait(&j->wake, &j->lock);
+      continue;
+    }
+    job->state = JOB_PARSING;
+    pthread_mutex_unlock(&j->lock);
+    t0 = now_ns();
+    p = program_new(job->filename);
+    ok = p && program_parse(p, j->machine) == EXIT_SUCCESS;
+    if (!ok) {
+      eprintf("Could not parse %s\n", job->filename);
+      if (p) program_free(p);
+      p = NULL;
+    }
+    pthread_mutex_lock(&j->lock);
+    job->prog = p;
+    job->parse_ns = now_ns() - t0;
+    job->state = ok ? JOB_READY : JOB_FAILED;
+    pthread_cond_broadcast(&j->parsed);
+  }
+  pthread_mutex_unlock(&j->lock);
+  return NULL;
+}
+
+// Take the first job, if parsed, or wait for it. Failed jobs were
+// reported by the loader: jobs_next() skips them, jobs_wait() gives up
+static jobs_status_t take(jobs_t *j, program_t **p, int wait) {
+  job_t *job;
+  jobs_status_t rv = JOBS_EMPTY;
+  pthread_mutex_lock(&j->lock);
+  while (wait && j->head && (j->head->state == JOB_QUEUED || j->head->state == JOB_PARSING)) {
+    pthread_cond_wait(&j->parsed, &j->lock);
+  }
+  while ((job = j->head) && (job->state == JOB_READY || job->state == JOB_FAILED)) {
+    j->head = job->next;
+    if (!j->head) j->tail = NULL;
+    j->pending--;
+    if (job->state == JOB_READY) {
+      *p = job->prog;
+      job->prog = NULL;
+      j->parse_ns = job->parse_ns;
+      rv = JOBS_READY;
+    }
+    else if (!wait) {
+      eprintf("Skipping %s\n", job->filename);
+    }
+    job_free(job);
+    // the loader can go on with the following one
+    pthread_cond_signal(&j->wake);
+    if (rv == JOBS_READY || wait) break;
+  }
+  if (rv != JOBS_READY && !wait && j->head) rv = JOBS_LOADING;
+  pthread_mutex_unlock(&j->lock);
+  return rv;
+}
+
+// First queued job, if fewer than JOBS_AHEAD are parsed (lock held)
+static job_t *next_to_parse(jobs_t *j) {
+  job_t *job;
+  size_t ready = 0;
+  for (job = j->head; job; job = job->next) {
+    if (job->state == JOB_READY) ready++;
+    if (ready >= JOBS_AHEAD) return NULL;
+    if (job->state == JOB_QUEUED) return job;
+  }
+  return NULL;
+}
+
+static void job_free(job_t *job) {
+  if (job->prog) program_free(job->prog);
+  free(job->filename);
+  free(job);
+}
@@ -0,0 +1,76 @@
+//       _       _
+//      | | ___ | |__  ___
+//   _  | |/ _ \| '_ \/ __|
+//  | |_| | (_) | |_) \__ \
+//   \___/ \___/|_.__/|___/
+//  Job queue class
+//  G-code files to be run back to back. A loader thread parses (and plans)
+//  the next queued program while the current one runs, so that the FSM
+//  only has to swap programs when a job ends: the machine stays connected
+//  and nothing is reinitialized. Programs that fail to parse are reported
+//  and skipped. At startup, the loader parses the first program while the
+//  machine connects.
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "defines.h"
+#include "machine.h"
+#include "program.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct jobs jobs_t;
+
+typedef enum {
+  JOBS_EMPTY = 0,       // nothing queued
+  JOBS_LOADING,         // the next program is still being parsed
+  JOBS_READY            // the next program is parsed
+} jobs_status_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Start the loader thread; programs are parsed with the machine m (only
+// its configuration is read). Returns NULL on failure
+jobs_t *jobs_new(machine_t *m);
+
+// Stop the loader thread (waiting for the program being parsed, if any)
+// and free the programs not taken yet
+void jobs_free(jobs_t *j);
+
+// QUEUE =======================================================================
+
+// Append a G-code file. Returns 0 on success
+int jobs_add(jobs_t *j, const char *filename);
+
+// Take the next program, if parsed: on JOBS_READY, *p is set and owned by
+// the caller. Never waits for the loader
+jobs_status_t jobs_next(jobs_t *j, program_t **p);
+
+// Like jobs_next(), but waits for the loader: returns JOBS_READY, or
+// JOBS_EMPTY if the next program could not be parsed (it is dropped) or
+// nothing is queued
+jobs_status_t jobs_wait(jobs_t *j, program_t **p);
+
+// GETTERS =====================================================================
+
+// Jobs queued and not taken yet
+size_t jobs_pending(jobs_t *j);
+
+// Parsing time of the last program taken (ns)
+uint64_t jobs_parse_time(jobs_t *j);
+
+#endif // JOBS_H
@@ -0,0 +1,206 @@
+//   _
+//  | |    ___   __ _  __ _  ___ _ __
+//  | |   / _ \ / _` |/ _` |/ _ \ '__|
+//  | |__| (_) | (_| | (_| |  __/ |
+//  |_____\___/ \__, |\__, |\___|_|
+//              |___/ |___/
+//
+
+#include "logger.h"
+#include "rt.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <inttypes.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// writer thread sleep when the ring is empty (ns)
+#define IDLE_SLEEP 5000000
+
+// a ring slot: a trajectory sample or the header line
+typedef struct {
+  int header;
+  log_record_t rec;
+} slot_t;
+
+// Logger object structure
+typedef struct logger {
+  FILE *out;
+  trace_t *trace;
+  unsigned columns;          // CSV columns (mask, see trace.h)
+  slot_t *ring;
+  size_t mask;               // capacity - 1
+  atomic_size_t head;        // next slot to write (realtime side only)
+  atomic_size_t tail;        // next slot to read (writer thread only)
+  atomic_uint_fast64_t dropped;
+  uint64_t written;
+  atomic_int running;
+  pthread_t writer;
+} logger_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int push(logger_t *l, int header, const log_record_t *rec);
+static size_t drain(logger_t *l);
+static void *writer_run(void *arg);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+logger_t *logger_new(FILE *out, trace_t *trace, size_t capacity) {
+  assert(out || trace);
+  size_t len = 1;
+  logger_t *l = (logger_t *)calloc(1, sizeof(logger_t));
+  if (!l) {
+    perror("Could not allocate logger");
+    return NULL;
+  }
+  while (len < capacity) len <<= 1;
+  l->ring = (slot_t *)calloc(len, sizeof(slot_t));
+  if (!l->ring) {
+    perror("Could not allocate logger ring");
+    free(l);
+    return NULL;
+  }
+  l->out = out;
+  l->trace = trace;
+  l->columns = TRACE_ALL_COLUMNS;
+  l->mask = len - 1;
+  atomic_init(&l->head, 0);
+  atomic_init(&l->tail, 0);
+  atomic_init(&l->dropped, 0);
+  atomic_init(&l->running, 1);
+  if (rt_thread_create(&l->writer, writer_run, l)) {
+    perror("Could not start logger thread");
+    free(l->ring);
+    free(l);
+    return NULL;
+  }
+  return l;
+}
+
+void logger_free(logger_t *l) {
+  assert(l);
+  uint64_t dropped;
+  atomic_store_explicit(&l->running, 0, memory_order_release);
+  pthread_join(l->writer, NULL);
+  dropped = atomic_load(&l->dropped);
+  if (dropped > 0) {
+    eprintf("Logger: %" PRIu64 " records written, %" PRIu64 " dropped (ring full)\n", l->written, dropped);
+  }
+  free(l->ring);
+  free(l);
+  l = NULL;
+}
+
+
+// LOGGING (realtime side) =====================================================
+
+int logger_header(logger_t *l) {
+  assert(l);
+  return push(l, 1, NULL);
+}
+
+int logger_push(logger_t *l, const log_record_t *rec) {
+  assert(l && rec);
+  return push(l, 0, rec);
+}
+
+
+// GETTERS =====================================================================
+
+void logger_set_columns(logger_t *l, unsigned columns) {
+  assert(l);
+  l->columns = columns;
+}
+
+uint64_t logger_written(const logger_t *l) {
+  assert(l);
+  return l->written;
+}
+
+uint64_t logger_dropped(const logger_t *l) {
+  assert(l);
+  return atomic_load(&((logger_t *)l)->dropped);
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+static int push(logger_t *l, int header, const log_record_t *rec) {
+  size_t head = atomic_load_explicit(&l->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&l->tail, memory_order_acquire);
+  slot_t *slot;
+  if (head - tail > l->mask) {
+    atomic_fetch_add_explicit(&l->dropped, 1, memory_order_relaxed);
+    return 1;
+  }
+  slot = &l->ring[head & l->mask];
+  slot->header = header;
+  if (rec) slot->rec = *rec;
+  // publish the slot only once it is filled in
+  atomic_store_explicit(&l->head, head + 1, memory_order_release);
+  return 0;
+}
+
+// Format and write everything in the ring, then flush: one write() per
+// batch rather than per record. Returns the number of slots consumed
+static size_t drain(logger_t *l) {
+  size_t tail = atomic_load_explicit(&l->tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&l->head, memory_order_acquire);
+  size_t count = head - tail;
+  slot_t *slot;
+  log_record_t *r;
+  data_t row[TRACE_COLUMNS];
+  for (; tail != head; tail++) {
+    slot = &l->ring[tail & l->mask];
+    r = &slot->rec;
+    // the trace has its column names in the file header
+    if (slot->header) {
+      if (l->out) trace_csv_header(l->out, l->columns);
+      continue;
+    }
+    row[0] = r->n;
+    row[1] = r->t_tot;
+    row[2] = r->t_blk;
+    row[3] = r->lambda;
+    row[4] = r->s;
+    row[5] = r->feed;
+    row[6] = r->x;
+    row[7] = r->y;
+    row[8] = r->z;
+    if (l->out) trace_csv_row(l->out, l->columns, row);
+    if (l->trace) trace_append(l->trace, row);
+    l->written++;
+  }
+  // hand the slots back to the realtime side
+  atomic_store_explicit(&l->tail, tail, memory_order_release);
+  if (count > 0 && l->out) fflush(l->out);
+  return count;
+}
+
+static void *writer_run(void *arg) {
+  logger_t *l = (logger_t *)arg;
+  struct timespec idle = {.tv_sec = 0, .tv_nsec = IDLE_SLEEP};
+  while (atomic_load_explicit(&l->running, memory_order_acquire)) {
+    if (drain(l) == 0) nanosleep(&idle, NULL);
+  }
+  // last records, pushed before logger_free()
+  drain(l);
+  return NULL;
+}
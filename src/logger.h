@@ -0,0 +1,77 @@
+//   _
+//  | |    ___   __ _  __ _  ___ _ __
+//  | |   / _ \ / _` |/ _` |/ _ \ '__|
+//  | |__| (_) | (_| | (_| |  __/ |
+//  |_____\___/ \__, |\__, |\___|_|
+//              |___/ |___/
+//  Logger class
+//  Asynchronous trajectory logger: the realtime tick stores raw records in
+//  a preallocated single-producer single-consumer ring (lock-free, no
+//  formatting, no system calls), and a background thread formats them as
+//  CSV and writes them out in batches, and/or appends them to a binary
+//  trace (see trace.h). If the ring is full, records are dropped and
+//  counted rather than blocking the tick.
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "defines.h"
+#include "trace.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct logger logger_t;
+
+// One trajectory sample, as in the CSV columns
+typedef struct {
+  size_t n;                  // block number
+  data_t t_tot, t_blk;       // total and block time
+  data_t lambda, s, feed;    // curvilinear abscissa (normalized and mm), feedrate
+  data_t x, y, z;            // setpoint
+} log_record_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Log to out as CSV and/or to trace (either can be NULL; neither is closed
+// by logger_free()) through a ring of capacity records, rounded up to a
+// power of two, and start the writer thread. Returns NULL on failure
+logger_t *logger_new(FILE *out, trace_t *trace, size_t capacity);
+
+// Write out everything still in the ring, stop the writer thread and print
+// a summary on stderr if records were dropped
+void logger_free(logger_t *l);
+
+// LOGGING (realtime side) =====================================================
+
+// Queue the CSV header line. Returns 0 on success, 1 if the ring is full
+int logger_header(logger_t *l);
+
+// Queue a record. Returns 0 on success, 1 if the ring is full (the record
+// is dropped)
+int logger_push(logger_t *l, const log_record_t *rec);
+
+// SETTERS =====================================================================
+
+// Columns of the CSV output (mask, see trace.h; default all). Call it
+// before logging anything; the columns of a trace are set in trace_open()
+void logger_set_columns(logger_t *l, unsigned columns);
+
+// GETTERS =====================================================================
+
+uint64_t logger_written(const logger_t *l);
+uint64_t logger_dropped(const logger_t *l);
+
+#endif // LOGGER_H
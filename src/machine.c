@@ -6,8 +6,15 @@
 //
 #include "machine.h"
 #include "inic.h"
+#include "shm_link.h"
+#include "dgram_link.h"
+#include "histogram.h"
+#include "axis.h"
+#include "timeline.h"
 #include <mqtt_protocol.h>
 #include <unistd.h>
+#include <stdatomic.h>
+#include <inttypes.h>
 
 
 //   ____            _                 _   _                 
@@ -17,42 +24,155 @@
 //  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
                                                           
 #define BUFLEN 1024
+
+// Feedback snapshot, written by on_message() (possibly from the network
+// thread) and read by the realtime side. It is a seqlock: the writer makes
+// seq odd while updating and even when done, readers retry until they see
+// the same even seq before and after copying the fields.
+typedef struct {
+  atomic_uint_fast64_t seq;     // seqlock counter
+  machine_status_t data;        // last received feedback
+} status_lock_t;
+
+// Outgoing setpoint, as handed to the transport. The machine is expected
+// to echo seq and t_sent in its status messages, for latency measurement
+typedef struct {
+  uint64_t seq;                 // setpoint sequence number
+  uint64_t t_sent;              // send time (ns, see now_ns())
+  data_t x, y, z;               // absolute coordinates (offset included)
+  int rapid;                    // rapid motion flag
+} setpoint_msg_t;
+
+// Transport backend: the same machine API can run over different
+// channels. Each backend implements these operations; status coming back
+// from the machine must be passed to status_update()
+typedef struct {
+  const char *name;
+  int (*connect)(machine_t *m);
+  int (*send)(machine_t *m, const setpoint_msg_t *sp);
+  int (*listen_start)(machine_t *m);
+  int (*listen_stop)(machine_t *m);
+  void (*update)(machine_t *m);
+  int (*fd)(const machine_t *m);
+  int (*want_write)(const machine_t *m);
+  void (*disconnect)(machine_t *m);
+  void (*free)(machine_t *m);
+} transport_t;
+
 typedef struct machine {
   data_t A, tq;                 // max acceleration and timestep
   data_t max_error, error;      // max positioning error and actual error
   point_t *zero, *offset;       // machine reference zero and workpiece offset
   point_t *setpoint, *position; // desired and actual position
+  int rapid_interp;             // if 1, rapids are interpolated like lines
+  point_t *rapid_v, *rapid_a;   // per-axis rapid feedrate and acceleration
+  const transport_t *tr;        // communication backend
+  // MQTT backend
   char broker_address[BUFLEN];
   int broker_port;
   char pub_topic[BUFLEN];
   char sub_topic[BUFLEN];
   char pub_buffer[BUFLEN];
   struct mosquitto *mqt;
-  struct mosquitto_message *msg;
-  int connecting;
+  machine_on_message on_message;
+  atomic_int connecting;        // set by on_connect, possibly from net thread
+  int threaded;                 // if 1, network loop runs in its own thread
+  setpoint_msg_t *queue;        // outgoing setpoints not yet published
+  size_t q_len, q_head, q_count;
+  machine_queue_policy_t q_policy;
+  machine_queue_stats_t q_stats;
+  histogram_t *q_depth;         // queue depth at every setpoint
+  int holding;                  // feed hold in progress (QUEUE_PAUSE)
+  // shared memory backend
+  char shm_name[BUFLEN];
+  shm_link_t *shm;
+  // datagram backend
+  dgram_family_t dgram_family;
+  char dgram_addr[BUFLEN];      // host (udp) or socket path prefix (unix)
+  int dgram_port;
+  dgram_link_t *dgram;
+  // simulated machine backend
+  data_t sim_omega_n, sim_zeta;  // axis closed loop dynamics
+  data_t sim_a_max, sim_v_max;   // axis saturations
+  int sim_substeps;              // integration steps per tq
+  axis_t *axes[3];
+  setpoint_msg_t sim_sp;         // last setpoint received
+  uint64_t sim_ticks;            // ticks simulated so far
+  // feedback
+  status_lock_t status;         // feedback snapshot (lock-free)
+  uint64_t status_seq;          // last snapshot seq seen by realtime side
+  uint64_t error_seq;           // snapshot seq of the last error taken
+  uint64_t ticks;               // controller clock (see machine_tick())
+  atomic_int override;          // feed override from the machine panel (%)
+  // latency instrumentation: round trips are measured by status_update()
+  // and handed over in the snapshot; the histograms belong to the
+  // realtime side
+  atomic_uint_fast64_t sp_seq;  // next setpoint sequence number
+  uint64_t ack_seq;             // last setpoint echoed back (status_update())
+  uint64_t rtt_seq;             // last round trip added to the histograms
+  histogram_t *latency;         // setpoint to feedback round trip (ns)
+  histogram_t *lag;             // setpoints in flight when feedback arrives
+  data_t stats_period;          // periodic dump interval (s), 0 to disable
+  uint64_t stats_last;          // last dump time (ns)
   data_t rt_pacing;
+  data_t tick_spin;             // busy-wait before each tick deadline (us)
+  int event_loop;               // if 1, c-cnc polls timer and socket together
 } machine_t;
 
 // callbacks
 static void on_connect(struct mosquitto *mqt, void *obj, int rc);
 static void on_message(struct mosquitto *mqt, void *ud, const struct mosquitto_message *msg);
+static void status_update(machine_t *m, const data_t *pos, const data_t *error, uint64_t ack_seq, uint64_t ack_time);
+static void stats_periodic(machine_t *m);
+static void latency_collect(machine_t *m, const machine_status_t *st);
+static void shm_update(machine_t *m);
+static void dgram_update(machine_t *m);
+static void sim_update(machine_t *m);
+static void mqtt_flush(machine_t *m);
+
+// transport backends
+static const transport_t mqtt_transport, shm_transport, dgram_transport, sim_transport;
+static const transport_t *transports[] = {
+  &mqtt_transport,
+  &shm_transport,
+  &dgram_transport,
+  &sim_transport,
+  NULL
+};
 
 //   _____                 _   _                 
 //  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___ 
 //  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
 //  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
 //  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
-                                              
+
 // LIFECYCLE ===================================================================
 
 // Create a new instance reading data from an INI file
 // If the INI file is not given (NULL), provide sensible default values
 machine_t *machine_new(const char *ini_path) {
   machine_t *m = (machine_t *)calloc(1, sizeof(machine_t));
+  char transport[BUFLEN] = "mqtt";
+  char family[BUFLEN];
+  char policy[BUFLEN] = "drop_oldest";
+  char rapid_mode[BUFLEN] = "feedback";
+  int queue_len = 64;
   if (!m) {
     perror("Error creating machine object");
     exit(EXIT_FAILURE);
   }
+  m->rapid_v = point_new();
+  m->rapid_a = point_new();
+  strcpy(m->shm_name, "/c-cnc");
+  m->dgram_family = DGRAM_UDP;
+  strcpy(m->dgram_addr, "127.0.0.1");
+  m->dgram_port = 9100;
+  m->sim_omega_n = 30;
+  m->sim_zeta = 0.9;
+  m->sim_a_max = 2000;
+  m->sim_v_max = 200;
+  m->sim_substeps = 10;
+  m->tick_spin = 100;
   if (ini_path) { // load values from INI file
     void *ini = ini_init(ini_path);
     data_t x, y, z;
@@ -75,10 +195,66 @@ machine_t *machine_new(const char *ini_path) {
     rc += ini_get_double(ini, "C-CNC", "offset_z", &z);
     m->offset = point_new();
     point_set_xyz(m->offset, x, y, z);
+    // optional: defaults to mqtt
+    if (ini_get_char(ini, "C-CNC", "transport", transport, BUFLEN))
+      strcpy(transport, "mqtt");
+    // optional: defaults to 0 (no periodic latency report)
+    ini_get_double(ini, "C-CNC", "stats_period", &m->stats_period);
+    // optional: defaults to 100 us
+    if (ini_get_double(ini, "C-CNC", "tick_spin", &m->tick_spin) || m->tick_spin < 0)
+      m->tick_spin = 100;
+    // optional: defaults to 0 (sleep-then-spin ticks, see ticker.h)
+    ini_get_int(ini, "C-CNC", "event_loop", &m->event_loop);
+    // optional: defaults to feedback (rapids wait for the machine)
+    if (ini_get_char(ini, "C-CNC", "rapid_mode", rapid_mode, BUFLEN))
+      strcpy(rapid_mode, "feedback");
+    // optional: per-axis rapid limits, default to 6000 mm/min and A
+    if (ini_get_double(ini, "C-CNC", "rapid_vx", &x)) x = 6000;
+    if (ini_get_double(ini, "C-CNC", "rapid_vy", &y)) y = 6000;
+    if (ini_get_double(ini, "C-CNC", "rapid_vz", &z)) z = 6000;
+    point_set_xyz(m->rapid_v, x, y, z);
+    if (ini_get_double(ini, "C-CNC", "rapid_ax", &x)) x = m->A;
+    if (ini_get_double(ini, "C-CNC", "rapid_ay", &y)) y = m->A;
+    if (ini_get_double(ini, "C-CNC", "rapid_az", &z)) z = m->A;
+    point_set_xyz(m->rapid_a, x, y, z);
     rc += ini_get_char(ini, "MQTT", "broker_addr", m->broker_address, BUFLEN);
     rc += ini_get_int(ini, "MQTT", "broker_port", &m->broker_port);
     rc += ini_get_char(ini, "MQTT", "pub_topic", m->pub_topic, BUFLEN);
     rc += ini_get_char(ini, "MQTT", "sub_topic", m->sub_topic, BUFLEN);
+    // optional: defaults to 0 (network loop inside the realtime tick)
+    ini_get_int(ini, "MQTT", "threaded", &m->threaded);
+    // optional: defaults to a queue of 64, dropping the oldest
+    if (ini_get_int(ini, "MQTT", "queue_len", &queue_len) || queue_len < 1)
+      queue_len = 64;
+    if (ini_get_char(ini, "MQTT", "queue_policy", policy, BUFLEN))
+      strcpy(policy, "drop_oldest");
+    // optional: defaults to /c-cnc
+    if (ini_get_char(ini, "SHM", "name", m->shm_name, BUFLEN))
+      strcpy(m->shm_name, "/c-cnc");
+    // optional: defaults to udp on 127.0.0.1:9100
+    if (!ini_get_char(ini, "DGRAM", "family", family, BUFLEN) &&
+        strcmp(family, "unix") == 0) {
+      m->dgram_family = DGRAM_UNIX;
+      if (ini_get_char(ini, "DGRAM", "path", m->dgram_addr, BUFLEN))
+        strcpy(m->dgram_addr, "/tmp/c-cnc");
+    }
+    else {
+      if (ini_get_char(ini, "DGRAM", "host", m->dgram_addr, BUFLEN))
+        strcpy(m->dgram_addr, "127.0.0.1");
+      if (ini_get_int(ini, "DGRAM", "port", &m->dgram_port))
+        m->dgram_port = 9100;
+    }
+    // optional: simulated axes dynamics
+    if (ini_get_double(ini, "SIM", "omega_n", &m->sim_omega_n))
+      m->sim_omega_n = 30;
+    if (ini_get_double(ini, "SIM", "zeta", &m->sim_zeta))
+      m->sim_zeta = 0.9;
+    if (ini_get_double(ini, "SIM", "a_max", &m->sim_a_max))
+      m->sim_a_max = 2000;
+    if (ini_get_double(ini, "SIM", "v_max", &m->sim_v_max))
+      m->sim_v_max = 200;
+    if (ini_get_int(ini, "SIM", "substeps", &m->sim_substeps) || m->sim_substeps < 1)
+      m->sim_substeps = 10;
     ini_free(ini);
     if (rc > 0) {
       fprintf(stderr, "Missing/wrong %d config parameters\n", rc);
@@ -97,12 +273,57 @@ machine_t *machine_new(const char *ini_path) {
     m->broker_port = 1883;
     strcpy(m->pub_topic, "c-cnc/setpoint");
     strcpy(m->sub_topic, "c-cnc/status/#");
+    point_set_xyz(m->rapid_v, 6000, 6000, 6000);
+    point_set_xyz(m->rapid_a, m->A, m->A, m->A);
+  }
+  if (machine_select_transport(m, transport)) {
+    fprintf(stderr, "Unknown transport %s\n", transport);
+    return NULL;
+  }
+  if (strcmp(policy, "drop_oldest") == 0) {
+    m->q_policy = QUEUE_DROP_OLDEST;
+  }
+  else if (strcmp(policy, "coalesce") == 0) {
+    m->q_policy = QUEUE_COALESCE;
+  }
+  else if (strcmp(policy, "pause") == 0) {
+    m->q_policy = QUEUE_PAUSE;
+  }
+  else {
+    fprintf(stderr, "Unknown queue policy %s\n", policy);
+    return NULL;
+  }
+  if (strcmp(rapid_mode, "interpolated") == 0) {
+    m->rapid_interp = 1;
+  }
+  else if (strcmp(rapid_mode, "feedback") != 0) {
+    fprintf(stderr, "Unknown rapid mode %s\n", rapid_mode);
+    return NULL;
+  }
+  if (m->rapid_interp && (point_x(m->rapid_v) <= 0 || point_y(m->rapid_v) <= 0 ||
+      point_z(m->rapid_v) <= 0 || point_x(m->rapid_a) <= 0 ||
+      point_y(m->rapid_a) <= 0 || point_z(m->rapid_a) <= 0)) {
+    fprintf(stderr, "Rapid feedrates and accelerations must be positive\n");
+    return NULL;
+  }
+  m->q_len = queue_len;
+  m->queue = (setpoint_msg_t *)calloc(m->q_len, sizeof(setpoint_msg_t));
+  m->q_depth = histogram_new();
+  if (!m->queue) {
+    perror("Error creating setpoint queue");
+    exit(EXIT_FAILURE);
   }
   m->setpoint = point_new();
   point_modal(m->zero, m->setpoint);
   m->position = point_new();
   m->error = m->max_error;
+  m->status.data.error = m->error;
   m->mqt = NULL;
+  m->shm = NULL;
+  m->dgram = NULL;
+  m->latency = histogram_new();
+  m->lag = histogram_new();
+  m->sp_seq = 1; // 0 means "no echo" in status messages
   if (mosquitto_lib_init() != MOSQ_ERR_SUCCESS) {
     perror("Could not initialize Mosquitto library");
     exit(EXIT_FAILURE);
@@ -117,95 +338,224 @@ void machine_free(machine_t *m) {
   point_free(m->offset);
   point_free(m->setpoint);
   point_free(m->position);
-  if (m->mqt) {
-    mosquitto_destroy(m->mqt);
-  }
+  point_free(m->rapid_v);
+  point_free(m->rapid_a);
+  histogram_free(m->latency);
+  histogram_free(m->lag);
+  histogram_free(m->q_depth);
+  free(m->queue);
+  m->tr->free(m);
   mosquitto_lib_cleanup();
   free(m);
   m = NULL;
 }
 
-// MQTT COMMUNICATIONS =========================================================
+// Select the communication backend by name (mqtt, shm, dgram or sim). Must be called
+// before machine_connect(). Returns 0 on success
+int machine_select_transport(machine_t *m, const char *name) {
+  assert(m && name);
+  int i;
+  for (i = 0; transports[i]; i++) {
+    if (strcmp(transports[i]->name, name) == 0) {
+      m->tr = transports[i];
+      return 0;
+    }
+  }
+  return 1;
+}
 
-// return value is 0 on success
-int machine_connect(machine_t *m, machine_on_message callback) {
-  assert(m);
-  m->mqt = mosquitto_new(NULL, 1, m);
-  if (!m->mqt) {
-    perror("Could not create MQTT");
+int machine_set_id(machine_t *m, const char *id) {
+  assert(m && id);
+  char *hash = strchr(m->sub_topic, '#');
+  if (strlen(m->pub_topic) + strlen(id) + 1 >= BUFLEN ||
+      strlen(m->sub_topic) + strlen(id) + 2 >= BUFLEN) {
+    eprintf("Machine id %s is too long\n", id);
     return 1;
   }
-  mosquitto_connect_callback_set(m->mqt, on_connect);
-  mosquitto_message_callback_set(m->mqt, callback ? callback : on_message);
-  if (mosquitto_connect(m->mqt, m->broker_address, m->broker_port, 60) != MOSQ_ERR_SUCCESS) {
-    perror("Could not connect to broker");
-    return 2;
-  }
-  // wait for connection to establish
-  while (m->connecting) {
-    mosquitto_loop(m->mqt, -1, 1);
+  strcat(m->pub_topic, "/");
+  strcat(m->pub_topic, id);
+  // "c-cnc/status/#" becomes "c-cnc/status/<id>/#"
+  if (hash) {
+    sprintf(hash, "%s/#", id);
   }
   return 0;
 }
 
+// COMMUNICATIONS ==============================================================
+
+// return value is 0 on success
+int machine_connect(machine_t *m, machine_on_message callback) {
+  assert(m);
+  m->on_message = callback;
+  return m->tr->connect(m);
+}
+
 int machine_sync(machine_t *m, int rapid) {
   assert(m);
-  //  remember that mosquitto_loop must be called in order to comms to happen
-  if (mosquitto_loop(m->mqt, 0, 1) != MOSQ_ERR_SUCCESS) {
-    perror("mosquitto_loop error");
-    return 1;
+  // compensate for the workpiece offset from the INI file:
+  setpoint_msg_t sp = {
+    .seq = atomic_fetch_add_explicit(&m->sp_seq, 1, memory_order_relaxed),
+    .t_sent = now_ns(),
+    .x = point_x(m->setpoint) + point_x(m->offset),
+    .y = point_y(m->setpoint) + point_y(m->offset),
+    .z = point_z(m->setpoint) + point_z(m->offset),
+    .rapid = rapid
+  };
+  machine_status_t st;
+  int rv;
+  // feedback may have come without machine_listen_update() (interpolation)
+  if (machine_status(m, &st)) latency_collect(m, &st);
+  stats_periodic(m);
+  rv = m->tr->send(m, &sp);
+  if (timeline_enabled()) {
+    timeline_span("net", rapid ? "sync_rapid" : "sync", sp.t_sent, now_ns(), "seq", sp.seq);
   }
-  // fill up pub_buffer with current set point, comma separated
-  // also, compensate for the workpiece offset from the INI file:
-  snprintf(m->pub_buffer, BUFLEN, "{\"x\":%f,\"y\":%f,\"z\":%f,\"rapid\":%s}", 
-    point_x(m->setpoint) + point_x(m->offset), 
-    point_y(m->setpoint) + point_y(m->offset), 
-    point_z(m->setpoint) + point_z(m->offset),
-    rapid ? "true" : "false"
-  );
-  // send buffer over MQTT
-  mosquitto_publish(m->mqt, NULL, m->pub_topic, strlen(m->pub_buffer), m->pub_buffer, 0, 0);
-  return 0;
+  return rv;
 }
 
 
 int machine_listen_start(machine_t *m) {
-  // subscribe to the topic where the machine publishes to
-  if (mosquitto_subscribe(m->mqt, NULL, m->sub_topic, 0) != MOSQ_ERR_SUCCESS) {
-    perror("Could not subscribe");
+  assert(m);
+  if (m->tr->listen_start(m)) {
     return 1;
   }
   m->error = m->max_error * 10.0;
-  eprintf("Subscribed to topic %s\n", m->sub_topic);
+  // ignore feedback received before this point: the position may still
+  // come, but only an error received later replaces the one above
+  m->status_seq = atomic_load_explicit(&m->status.seq, memory_order_acquire) / 2;
+  m->error_seq = m->status_seq;
   return 0;
 }
 
 int machine_listen_stop(machine_t *m) {
-  if (mosquitto_unsubscribe(m->mqt, NULL, m->sub_topic) != MOSQ_ERR_SUCCESS) {
-    perror("Could not unsubscribe");
-    return 1;
-  }
-  eprintf("Unsubscribed from topic %s\n", m->sub_topic);
-  return 0;
+  assert(m);
+  return m->tr->listen_stop(m);
 }
 
 void machine_listen_update(machine_t *m) {
-  // call mosquitto_loop
-  if (mosquitto_loop(m->mqt, 0, 1) != MOSQ_ERR_SUCCESS) {
-    perror("mosquitto_loop error");
+  machine_status_t st;
+  // let the backend process incoming traffic
+  m->tr->update(m);
+  stats_periodic(m);
+  // take a consistent copy of the feedback, if anything new arrived
+  if (machine_status(m, &st) && st.seq != m->status_seq) {
+    m->status_seq = st.seq;
+    latency_collect(m, &st);
+    if (st.error_seq > m->error_seq) {
+      m->error_seq = st.error_seq;
+      m->error = st.error;
+    }
+    point_set_xyz(m->position, st.x, st.y, st.z);
   }
 }
 
+void machine_tick(machine_t *m) {
+  assert(m);
+  m->ticks++;
+}
+
+int machine_fd(const machine_t *m) {
+  assert(m);
+  return m->tr->fd(m);
+}
+
+int machine_want_write(const machine_t *m) {
+  assert(m);
+  return m->tr->want_write(m);
+}
+
+int machine_override(const machine_t *m) {
+  assert(m);
+  return atomic_load_explicit(&((machine_t *)m)->override, memory_order_relaxed);
+}
+
+// Copy the latest feedback snapshot into st, without locks nor allocations.
+// Returns 0 if no feedback has been received yet, 1 otherwise
+int machine_status(const machine_t *m, machine_status_t *st) {
+  assert(m && st);
+  uint_fast64_t s0, s1;
+  status_lock_t *lk = (status_lock_t *)&m->status;
+  do {
+    s0 = atomic_load_explicit(&lk->seq, memory_order_acquire);
+    if (s0 & 1) continue; // writer in progress
+    *st = lk->data;
+    atomic_thread_fence(memory_order_acquire);
+    s1 = atomic_load_explicit(&lk->seq, memory_order_relaxed);
+  } while ((s0 & 1) || s0 != s1);
+  st->seq = s0 / 2;
+  return s0 > 0;
+}
+
+int machine_hold(machine_t *m) {
+  assert(m);
+  if (m->q_policy != QUEUE_PAUSE) return 0;
+  m->tr->update(m);
+  // hold when 3/4 full, resume when down to 1/4, so that motion does not
+  // stutter at the threshold
+  if (!m->holding && m->q_count * 4 >= m->q_len * 3) {
+    m->holding = 1;
+    eprintf("Setpoint queue backed up (%zu), holding\n", m->q_count);
+  }
+  else if (m->holding && m->q_count * 4 <= m->q_len) {
+    m->holding = 0;
+    eprintf("Setpoint queue drained, resuming\n");
+  }
+  if (m->holding) m->q_stats.hold_ticks++;
+  return m->holding;
+}
+
+void machine_queue_stats(const machine_t *m, machine_queue_stats_t *qs) {
+  assert(m && qs);
+  *qs = m->q_stats;
+  qs->depth = m->q_count;
+}
+
 void machine_disconnect(machine_t *m) {
-  if (m->mqt) {
-    while (mosquitto_want_write(m->mqt)) {
-      mosquitto_loop(m->mqt, 0, 1);
-      usleep(10000);
-    }
-    mosquitto_disconnect(m->mqt);
+  assert(m);
+  machine_status_t st;
+  m->tr->disconnect(m);
+  // the network thread is gone: take its last round trip
+  if (machine_status(m, &st)) latency_collect(m, &st);
+  if (histogram_count(m->latency) > 0 || m->q_stats.published > 0) {
+    machine_stats_print(m, stderr);
+  }
+}
+
+// LATENCY STATISTICS ==========================================================
+
+// Round trip time from machine_sync() to the feedback echoing that
+// setpoint, in ns. Sampled by machine_sync() and machine_listen_update()
+const histogram_t *machine_latency(const machine_t *m) {
+  assert(m);
+  return m->latency;
+}
+
+// Number of setpoints sent but not yet echoed when feedback arrives
+const histogram_t *machine_lag(const machine_t *m) {
+  assert(m);
+  return m->lag;
+}
+
+void machine_stats_print(const machine_t *m, FILE *out) {
+  assert(m && out);
+  histogram_print(m->latency, out, "Setpoint-to-feedback latency", 1E3, "us");
+  histogram_print(m->lag, out, "Setpoints in flight", 1, "");
+  if (m->q_stats.published > 0) {
+    histogram_print(m->q_depth, out, "Outgoing queue depth", 1, "");
+    fprintf(out, "Outgoing queue: %" PRIu64 " published, %" PRIu64 " dropped, %" PRIu64 " coalesced, "
+      "%" PRIu64 " errors, %" PRIu64 " ticks on hold\n", m->q_stats.published,
+      m->q_stats.dropped, m->q_stats.coalesced, m->q_stats.errors,
+      m->q_stats.hold_ticks);
   }
 }
 
+void machine_stats_reset(machine_t *m) {
+  assert(m);
+  histogram_reset(m->latency);
+  histogram_reset(m->lag);
+  histogram_reset(m->q_depth);
+}
+
 
 // ACCESSORS ===================================================================
 
@@ -224,6 +574,17 @@ machine_getter(point_t *, offset);
 machine_getter(point_t *, setpoint);
 machine_getter(point_t *, position);
 machine_getter(data_t, rt_pacing);
+machine_getter(data_t, tick_spin);
+machine_getter(int, event_loop);
+machine_getter(int, threaded);
+machine_getter(int, rapid_interp);
+machine_getter(point_t *, rapid_v);
+machine_getter(point_t *, rapid_a);
+
+const char *machine_transport(const machine_t *m) {
+  assert(m);
+  return m->tr->name;
+}
 
 
 
@@ -253,23 +614,499 @@ static void on_message(struct mosquitto *mqt, void *ud, const struct mosquitto_m
   // subtopic is the last word in the MQTT topic
   // strrchr returns a pointer to the last occourrence of a given char
   char *subtopic = strrchr(msg->topic, '/') + 1;
+  // the payload is parsed in place (libmosquitto NUL-terminates it)
+  char *nxt = msg->payload;
+  uint64_t t0 = now_ns();
 
   eprintf("<- message: %s:%s\n", msg->topic, (char *)msg->payload);
-  mosquitto_message_copy(m->msg, msg);
+
+  // both payloads may end with ",seq,t_sent" of the last setpoint received
+  // by the machine, for latency measurement
+  uint64_t ack_seq = 0, ack_time = 0;
 
   // if the last topic part is "error", then take it as a single value
   if (strcmp(subtopic, "error") == 0 ) {
-    m->error = atof(msg->payload);
+    data_t error = strtod(nxt, &nxt);
+    if (*nxt == ',') {
+      ack_seq = strtoull(nxt+1, &nxt, 10);
+      if (*nxt == ',') ack_time = strtoull(nxt+1, &nxt, 10);
+    }
+    status_update(m, NULL, &error, ack_seq, ack_time);
   }
   else if (strcmp(subtopic, "position") == 0) {
     // we have to parse a string like "123.4,100.0,-98" into three
     // coordinate values x, y, and z
-    char *nxt = msg->payload;
-    point_set_x(m->position, strtod(nxt, &nxt));
-    point_set_y(m->position, strtod(nxt+1, &nxt));
-    point_set_z(m->position, strtod(nxt+1, &nxt));
+    data_t pos[3];
+    pos[0] = strtod(nxt, &nxt);
+    pos[1] = strtod(nxt+1, &nxt);
+    pos[2] = strtod(nxt+1, &nxt);
+    if (*nxt == ',') {
+      ack_seq = strtoull(nxt+1, &nxt, 10);
+      if (*nxt == ',') ack_time = strtoull(nxt+1, &nxt, 10);
+    }
+    status_update(m, pos, NULL, ack_seq, ack_time);
+  }
+  // the feed override knob on the machine panel, in percent
+  else if (strcmp(subtopic, "override") == 0) {
+    atomic_store_explicit(&m->override, (int)strtol(nxt, NULL, 10), memory_order_relaxed);
   }
   else {
     eprintf("Got unexpected message on %s\n", msg->topic);
   }
-}
\ No newline at end of file
+  timeline_span("net", "on_message", t0, now_ns(), NULL, 0);
+}
+
+// Seqlock writer side: update position and/or error (NULL ones are left
+// untouched). There is only one writer (the thread running the network
+// loop), so a plain increment is enough.
+// ack_seq and ack_time echo the last setpoint seen by the machine (0 if the
+// machine does not echo them): they feed the latency histograms, once per
+// setpoint
+static void status_update(machine_t *m, const data_t *pos, const data_t *error, uint64_t ack_seq, uint64_t ack_time) {
+  status_lock_t *st = &m->status;
+  uint64_t now = now_ns();
+  uint64_t sent = atomic_load_explicit(&m->sp_seq, memory_order_relaxed);
+  uint_fast64_t s = atomic_load_explicit(&st->seq, memory_order_relaxed);
+  // stale or reordered echoes are not measured; nor are the bogus ones
+  // (never sent, or from the future)
+  int sample = ack_seq > m->ack_seq && ack_seq < sent && ack_time > 0 && ack_time <= now;
+  if (sample) m->ack_seq = ack_seq;
+  atomic_store_explicit(&st->seq, s + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  if (pos) {
+    st->data.x = pos[0];
+    st->data.y = pos[1];
+    st->data.z = pos[2];
+  }
+  if (error) {
+    st->data.error = *error;
+    st->data.error_seq = s / 2 + 1; // the seq readers will see
+  }
+  if (ack_seq > st->data.ack_seq) {
+    st->data.ack_seq = ack_seq;
+  }
+  if (sample) {
+    st->data.rtt_seq = ack_seq;
+    st->data.rtt = now - ack_time;
+    st->data.lag = sent - 1 - ack_seq;
+  }
+  st->data.t_recv = now;
+  atomic_store_explicit(&st->seq, s + 2, memory_order_release);
+  timeline_instant("net", "feedback", "ack_seq", ack_seq);
+}
+
+// Add the last round trip measured to the histograms, if new (samples
+// at the tick rate: with more feedback per tick, only the last one counts)
+static void latency_collect(machine_t *m, const machine_status_t *st) {
+  if (st->rtt_seq <= m->rtt_seq) return;
+  m->rtt_seq = st->rtt_seq;
+  histogram_add(m->latency, st->rtt);
+  histogram_add(m->lag, st->lag);
+}
+
+// Dump the latency statistics every stats_period seconds
+static void stats_periodic(machine_t *m) {
+  uint64_t now;
+  if (m->stats_period <= 0) return;
+  now = now_ns();
+  if (m->stats_last == 0) m->stats_last = now;
+  if (now - m->stats_last >= m->stats_period * 1E9) {
+    m->stats_last = now;
+    machine_stats_print(m, stderr);
+  }
+}
+
+
+// MQTT TRANSPORT ==============================================================
+
+static int mqtt_connect(machine_t *m) {
+  m->mqt = mosquitto_new(NULL, 1, m);
+  if (!m->mqt) {
+    perror("Could not create MQTT");
+    return 1;
+  }
+  mosquitto_connect_callback_set(m->mqt, on_connect);
+  mosquitto_message_callback_set(m->mqt, m->on_message ? m->on_message : on_message);
+  if (mosquitto_connect(m->mqt, m->broker_address, m->broker_port, 60) != MOSQ_ERR_SUCCESS) {
+    perror("Could not connect to broker");
+    return 2;
+  }
+  // in threaded mode, libmosquitto runs the network loop in a background
+  // thread, so that socket I/O never happens within the realtime tick
+  if (m->threaded) {
+    if (mosquitto_loop_start(m->mqt) != MOSQ_ERR_SUCCESS) {
+      perror("Could not start network thread");
+      return 3;
+    }
+    while (m->connecting) {
+      usleep(1000);
+    }
+    return 0;
+  }
+  // wait for connection to establish
+  while (m->connecting) {
+    mosquitto_loop(m->mqt, -1, 1);
+  }
+  return 0;
+}
+
+// Setpoints are not handed to libmosquitto directly: its own queue is
+// unbounded, and when the broker lags it would deliver stale setpoints
+// ever later. They go through a bounded queue, and are published only when
+// libmosquitto has nothing left to write (see mqtt_flush())
+static int mqtt_send(machine_t *m, const setpoint_msg_t *sp) {
+  //  remember that mosquitto_loop must be called in order to comms to happen
+  //  (unless the network thread is doing that for us)
+  if (!m->threaded && mosquitto_loop(m->mqt, 0, 1) != MOSQ_ERR_SUCCESS) {
+    perror("mosquitto_loop error");
+    return 1;
+  }
+  // older setpoints first
+  mqtt_flush(m);
+  if (m->q_count > 0 && m->q_policy == QUEUE_COALESCE) {
+    // the broker is lagging: only the latest setpoint matters
+    m->q_stats.coalesced += m->q_count;
+    m->q_count = 0;
+  }
+  else if (m->q_count == m->q_len) {
+    // with QUEUE_PAUSE this only happens if the caller ignores machine_hold()
+    m->q_head = (m->q_head + 1) % m->q_len;
+    m->q_count--;
+    m->q_stats.dropped++;
+  }
+  m->queue[(m->q_head + m->q_count) % m->q_len] = *sp;
+  m->q_count++;
+  if (m->q_count > m->q_stats.max_depth) m->q_stats.max_depth = m->q_count;
+  histogram_add(m->q_depth, m->q_count);
+  mqtt_flush(m);
+  return 0;
+}
+
+// Publish queued setpoints, oldest first, while libmosquitto keeps up
+static void mqtt_flush(machine_t *m) {
+  setpoint_msg_t *sp;
+  int rc;
+  // in threaded mode packets are written asynchronously by the network
+  // thread, so want_write only tells whether it kept up with the last batch
+  if (m->threaded && mosquitto_want_write(m->mqt)) return;
+  while (m->q_count > 0) {
+    if (!m->threaded && mosquitto_want_write(m->mqt)) break;
+    sp = &m->queue[m->q_head];
+    // fill up pub_buffer with current set point, comma separated
+    snprintf(m->pub_buffer, BUFLEN, "{\"x\":%f,\"y\":%f,\"z\":%f,\"rapid\":%s,\"seq\":%" PRIu64 ",\"t\":%" PRIu64 "}",
+      sp->x, sp->y, sp->z, sp->rapid ? "true" : "false", sp->seq, sp->t_sent
+    );
+    // send buffer over MQTT: in threaded mode this only enqueues the packet
+    rc = mosquitto_publish(m->mqt, NULL, m->pub_topic, strlen(m->pub_buffer), m->pub_buffer, 0, 0);
+    if (rc == MOSQ_ERR_NO_CONN || rc == MOSQ_ERR_ERRNO) {
+      // not connected (yet): keep it queued and try again later
+      m->q_stats.errors++;
+      break;
+    }
+    if (rc != MOSQ_ERR_SUCCESS) {
+      // will never go through: drop it
+      eprintf("Could not publish setpoint: %s\n", mosquitto_strerror(rc));
+      m->q_stats.errors++;
+    }
+    else {
+      m->q_stats.published++;
+    }
+    m->q_head = (m->q_head + 1) % m->q_len;
+    m->q_count--;
+  }
+}
+
+static int mqtt_listen_start(machine_t *m) {
+  // subscribe to the topic where the machine publishes to
+  if (mosquitto_subscribe(m->mqt, NULL, m->sub_topic, 0) != MOSQ_ERR_SUCCESS) {
+    perror("Could not subscribe");
+    return 1;
+  }
+  eprintf("Subscribed to topic %s\n", m->sub_topic);
+  return 0;
+}
+
+static int mqtt_listen_stop(machine_t *m) {
+  if (mosquitto_unsubscribe(m->mqt, NULL, m->sub_topic) != MOSQ_ERR_SUCCESS) {
+    perror("Could not unsubscribe");
+    return 1;
+  }
+  eprintf("Unsubscribed from topic %s\n", m->sub_topic);
+  return 0;
+}
+
+static void mqtt_update(machine_t *m) {
+  // call mosquitto_loop, unless the network thread is already doing that
+  if (!m->threaded && mosquitto_loop(m->mqt, 0, 1) != MOSQ_ERR_SUCCESS) {
+    perror("mosquitto_loop error");
+  }
+  mqtt_flush(m);
+}
+
+static int mqtt_fd(const machine_t *m) {
+  // in threaded mode the socket belongs to the network thread
+  return (m->mqt && !m->threaded) ? mosquitto_socket(m->mqt) : -1;
+}
+
+static int mqtt_want_write(const machine_t *m) {
+  // setpoints still queued are pushed by mqtt_flush() once this clears
+  return (m->mqt && !m->threaded) ? mosquitto_want_write(m->mqt) : 0;
+}
+
+static void mqtt_disconnect(machine_t *m) {
+  uint64_t t0 = now_ns();
+  if (m->mqt) {
+    // give queued setpoints up to one second to go out
+    while ((m->q_count > 0 || mosquitto_want_write(m->mqt)) && now_ns() - t0 < 1E9) {
+      if (!m->threaded) mosquitto_loop(m->mqt, 0, 1);
+      mqtt_flush(m);
+      usleep(10000);
+    }
+    if (m->q_count > 0) {
+      eprintf("%zu queued setpoints never published\n", m->q_count);
+    }
+    mosquitto_disconnect(m->mqt);
+    if (m->threaded) mosquitto_loop_stop(m->mqt, false);
+  }
+}
+
+static void mqtt_free(machine_t *m) {
+  if (m->mqt) {
+    mosquitto_destroy(m->mqt);
+  }
+}
+
+static const transport_t mqtt_transport = {
+  .name = "mqtt",
+  .connect = mqtt_connect,
+  .send = mqtt_send,
+  .listen_start = mqtt_listen_start,
+  .listen_stop = mqtt_listen_stop,
+  .update = mqtt_update,
+  .fd = mqtt_fd,
+  .want_write = mqtt_want_write,
+  .disconnect = mqtt_disconnect,
+  .free = mqtt_free
+};
+
+
+// SHARED MEMORY TRANSPORT =====================================================
+
+static int shm_connect(machine_t *m) {
+  m->shm = shm_link_open(m->shm_name, SHM_CONTROLLER);
+  if (!m->shm) {
+    return 1;
+  }
+  // forget anything left over by a previous run
+  shm_link_drain(m->shm);
+  eprintf("-> Connected to shared memory %s\n", m->shm_name);
+  return 0;
+}
+
+static int shm_send(machine_t *m, const setpoint_msg_t *sp) {
+  // consume pending feedback, as mosquitto_loop() does for MQTT, so that
+  // latency is measured also while not listening
+  shm_update(m);
+  shm_msg_t msg = {
+    .seq = sp->seq,
+    .t_sent = sp->t_sent,
+    .x = sp->x, .y = sp->y, .z = sp->z,
+    .rapid = sp->rapid
+  };
+  if (shm_link_send(m->shm, &msg)) {
+    eprintf("Shared memory ring full, setpoint dropped\n");
+    return 1;
+  }
+  return 0;
+}
+
+// nothing to subscribe to: status is always flowing
+static int nop_listen(machine_t *m) {
+  return 0;
+}
+
+// nothing to poll
+static int nop_fd(const machine_t *m) {
+  return -1;
+}
+
+// sends never block, nothing is left pending
+static int nop_want_write(const machine_t *m) {
+  return 0;
+}
+
+static void shm_update(machine_t *m) {
+  shm_msg_t msg;
+  // consume everything, only the latest status matters
+  while (shm_link_recv(m->shm, &msg)) {
+    data_t pos[3] = {msg.x, msg.y, msg.z};
+    status_update(m, pos, &msg.error, msg.seq, msg.t_sent);
+  }
+}
+
+static void shm_disconnect(machine_t *m) {
+  return;
+}
+
+static void shm_free(machine_t *m) {
+  if (m->shm) {
+    shm_link_close(m->shm);
+  }
+}
+
+static const transport_t shm_transport = {
+  .name = "shm",
+  .connect = shm_connect,
+  .send = shm_send,
+  .listen_start = nop_listen,
+  .listen_stop = nop_listen,
+  .update = shm_update,
+  .fd = nop_fd,
+  .want_write = nop_want_write,
+  .disconnect = shm_disconnect,
+  .free = shm_free
+};
+
+
+// DATAGRAM TRANSPORT ==========================================================
+
+static int dgram_connect(machine_t *m) {
+  m->dgram = dgram_link_open(m->dgram_family, m->dgram_addr, m->dgram_port, DGRAM_CONTROLLER);
+  return m->dgram ? 0 : 1;
+}
+
+static int dgram_send(machine_t *m, const setpoint_msg_t *sp) {
+  // consume pending feedback (see shm_send())
+  dgram_update(m);
+  dgram_msg_t msg = {
+    .sp_seq = sp->seq,
+    .sp_time = sp->t_sent,
+    .x = sp->x, .y = sp->y, .z = sp->z,
+    .rapid = sp->rapid
+  };
+  return dgram_link_send(m->dgram, &msg);
+}
+
+static void dgram_update(machine_t *m) {
+  dgram_msg_t msg;
+  // out-of-order packets are already discarded by the link
+  while (dgram_link_recv(m->dgram, &msg)) {
+    data_t pos[3] = {msg.x, msg.y, msg.z};
+    status_update(m, pos, &msg.error, msg.sp_seq, msg.sp_time);
+  }
+}
+
+static int dgram_fd(const machine_t *m) {
+  return m->dgram ? dgram_link_fd(m->dgram) : -1;
+}
+
+static void dgram_disconnect(machine_t *m) {
+  dgram_stats_t st;
+  if (m->dgram) {
+    dgram_link_stats(m->dgram, &st);
+    eprintf("Datagram link: %" PRIu64 " sent, %" PRIu64 " received, %" PRIu64 " lost, %" PRIu64 " reordered, %" PRIu64 " duplicated\n",
+      st.sent, st.received, st.lost, st.reordered, st.duplicated);
+  }
+}
+
+static void dgram_free(machine_t *m) {
+  if (m->dgram) {
+    dgram_link_close(m->dgram);
+  }
+}
+
+static const transport_t dgram_transport = {
+  .name = "dgram",
+  .connect = dgram_connect,
+  .send = dgram_send,
+  .listen_start = nop_listen,
+  .listen_stop = nop_listen,
+  .update = dgram_update,
+  .fd = dgram_fd,
+  .want_write = nop_want_write,
+  .disconnect = dgram_disconnect,
+  .free = dgram_free
+};
+
+
+// SIMULATED MACHINE TRANSPORT =================================================
+// No real machine at all: each axis is simulated in process (see axis.h),
+// and the simulation advances by tq per controller tick (machine_tick()),
+// regardless of the wall clock: machine_sync(), machine_listen_update()
+// and machine_hold() catch up with the ticks elapsed, if any. With
+// rt_pacing = 0 programs run as fast as the CPU allows
+
+static int sim_connect(machine_t *m) {
+  int i;
+  data_t start[3] = {
+    point_x(m->zero) + point_x(m->offset),
+    point_y(m->zero) + point_y(m->offset),
+    point_z(m->zero) + point_z(m->offset)
+  };
+  for (i = 0; i < 3; i++) {
+    if (!m->axes[i]) {
+      m->axes[i] = axis_new(m->sim_omega_n, m->sim_zeta, m->sim_a_max, m->sim_v_max);
+    }
+    axis_reset(m->axes[i], start[i]);
+  }
+  m->sim_sp.x = start[0];
+  m->sim_sp.y = start[1];
+  m->sim_sp.z = start[2];
+  m->sim_ticks = m->ticks;
+  eprintf("-> Simulating axes (omega_n %.1f rad/s, zeta %.2f, a_max %.0f mm/s^2, v_max %.0f mm/s)\n",
+    m->sim_omega_n, m->sim_zeta, m->sim_a_max, m->sim_v_max);
+  return 0;
+}
+
+static int sim_send(machine_t *m, const setpoint_msg_t *sp) {
+  m->sim_sp = *sp;
+  sim_update(m);
+  return 0;
+}
+
+static void sim_update(machine_t *m) {
+  data_t sp[3] = {m->sim_sp.x, m->sim_sp.y, m->sim_sp.z};
+  data_t pos[3], error = 0, dt = m->tq / m->sim_substeps;
+  uint64_t k, steps = (m->ticks - m->sim_ticks) * m->sim_substeps;
+  int i;
+  // already simulated up to this tick
+  if (m->sim_ticks >= m->ticks) return;
+  m->sim_ticks = m->ticks;
+  for (i = 0; i < 3; i++) {
+    for (k = 0; k < steps; k++) {
+      axis_step(m->axes[i], sp[i], dt);
+    }
+    pos[i] = axis_position(m->axes[i]);
+    error += (sp[i] - pos[i]) * (sp[i] - pos[i]);
+  }
+  error = sqrt(error);
+  // no time stamp: latency here would only measure the simulation itself
+  status_update(m, pos, &error, m->sim_sp.seq, 0);
+}
+
+static void sim_disconnect(machine_t *m) {
+  return;
+}
+
+static void sim_free(machine_t *m) {
+  int i;
+  for (i = 0; i < 3; i++) {
+    if (m->axes[i]) {
+      axis_free(m->axes[i]);
+      m->axes[i] = NULL;
+    }
+  }
+}
+
+static const transport_t sim_transport = {
+  .name = "sim",
+  .connect = sim_connect,
+  .send = sim_send,
+  .listen_start = nop_listen,
+  .listen_stop = nop_listen,
+  .update = sim_update,
+  .fd = nop_fd,
+  .want_write = nop_want_write,
+  .disconnect = sim_disconnect,
+  .free = sim_free
+};
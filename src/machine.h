@@ -10,6 +10,7 @@
 
 #include "defines.h"
 #include "point.h"
+#include "histogram.h"
 #include <mosquitto.h>
 
 //   _____                      
@@ -22,6 +23,38 @@
 // Opaque struct
 typedef struct machine machine_t;
 
+// Consistent copy of the latest feedback received from the machine
+typedef struct {
+  data_t x, y, z;   // actual position
+  data_t error;     // positioning error
+  uint64_t t_recv;  // receive time of the last update (ns, see now_ns())
+  uint64_t seq;     // number of updates received so far
+  uint64_t error_seq; // update that last carried the error (0 if none)
+  uint64_t ack_seq; // last setpoint echoed back by the machine (0 if none)
+  uint64_t rtt_seq; // setpoint of the last round trip measured (0 if none)
+  uint64_t rtt;     // its setpoint-to-feedback round trip (ns)
+  uint64_t lag;     // setpoints sent after it, when its feedback arrived
+} machine_status_t;
+
+// What to do with setpoints that cannot be published yet, because the
+// broker or the network lags behind ([MQTT] queue_policy)
+typedef enum {
+  QUEUE_DROP_OLDEST = 0, // bounded queue, the oldest setpoint goes first
+  QUEUE_COALESCE,        // only the latest setpoint is kept
+  QUEUE_PAUSE            // stop interpolating until the queue drains
+} machine_queue_policy_t;
+
+// Outgoing setpoint queue metrics
+typedef struct {
+  size_t depth;          // setpoints currently queued
+  size_t max_depth;      // highest depth so far
+  uint64_t published;    // handed over to libmosquitto
+  uint64_t dropped;      // discarded because the queue was full
+  uint64_t coalesced;    // superseded by a newer setpoint
+  uint64_t errors;       // mosquitto_publish() failures
+  uint64_t hold_ticks;   // ticks spent holding (QUEUE_PAUSE)
+} machine_queue_stats_t;
+
 //   _____                 _   _                 
 //  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___ 
 //  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
@@ -34,7 +67,18 @@ typedef struct machine machine_t;
 machine_t *machine_new(const char *ini_path);
 void machine_free(machine_t *m);
 
-// MQTT COMMUNICATIONS =========================================================
+// select the communication backend ("mqtt", "shm", "dgram" or "sim"),
+// before connecting
+int machine_select_transport(machine_t *m, const char *name);
+
+// tag the MQTT topics with an instance id, so that many machines can share
+// a broker: setpoints go to <pub_topic>/<id> and status is expected under
+// <sub_topic>/<id>/. Call before connecting
+int machine_set_id(machine_t *m, const char *id);
+
+// COMMUNICATIONS ==============================================================
+// The same API works over any backend: the MQTT-specific callback is ignored
+// by the others
 
 typedef void (* machine_on_message)(struct mosquitto *mqt, void *ud, const struct mosquitto_message *msg);
 
@@ -42,12 +86,51 @@ int machine_connect(machine_t *m, machine_on_message callback);
 
 int machine_sync(machine_t *m, int rapid);
 
+// With QUEUE_PAUSE, returns 1 while the outgoing queue is backed up and
+// motion should be held (with hysteresis), 0 otherwise. Call once per tick
+// instead of computing the next setpoint; it keeps the queue flowing
+int machine_hold(machine_t *m);
+
+void machine_queue_stats(const machine_t *m, machine_queue_stats_t *qs);
+
 int machine_listen_start(machine_t *m);
 
 int machine_listen_stop(machine_t *m);
 
 void machine_listen_update(machine_t *m);
 
+// Advance the controller clock by one tick (tq); call once per tick. The
+// simulated transport steps its axes to this clock, however many times
+// it is called in a tick
+void machine_tick(machine_t *m);
+
+// File descriptor that becomes readable when feedback arrives (then call
+// machine_listen_update()), or -1 if the backend has none. Valid after
+// machine_connect()
+int machine_fd(const machine_t *m);
+
+// 1 if outgoing data is waiting for machine_fd() to become writable (then
+// call machine_listen_update()), 0 otherwise
+int machine_want_write(const machine_t *m);
+
+int machine_status(const machine_t *m, machine_status_t *st);
+
+// Last feed override (%) published by the machine on the "override" status
+// subtopic (MQTT transport), 0 if none was received
+int machine_override(const machine_t *m);
+
+// LATENCY STATISTICS ==========================================================
+// Setpoints carry a sequence number and a timestamp that the machine echoes
+// in its status messages; round trips are collected into histograms
+
+const histogram_t *machine_latency(const machine_t *m);
+
+const histogram_t *machine_lag(const machine_t *m);
+
+void machine_stats_print(const machine_t *m, FILE *out);
+
+void machine_stats_reset(machine_t *m);
+
 void machine_disconnect(machine_t *m);
 
 // ACCESSORS ===================================================================
@@ -70,6 +153,26 @@ data_t machine_error(const machine_t *m);
 
 data_t machine_rt_pacing(const machine_t *m);
 
+// final part of each tick spent busy-waiting rather than sleeping (us)
+data_t machine_tick_spin(const machine_t *m);
+
+// 1 if the main loop waits on the tick timer and on machine_fd() at once
+int machine_event_loop(const machine_t *m);
+
+int machine_threaded(const machine_t *m);
+
+// 1 if rapids are interpolated with the per-axis limits below, 0 if the
+// target is sent at once and reached at the machine's own pace
+int machine_rapid_interp(const machine_t *m);
+
+// per-axis rapid feedrate (mm/min)
+point_t *machine_rapid_v(const machine_t *m);
+
+// per-axis rapid acceleration (mm/s^2)
+point_t *machine_rapid_a(const machine_t *m);
+
+const char *machine_transport(const machine_t *m);
+
 
 
 
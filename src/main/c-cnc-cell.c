@@ -0,0 +1,266 @@
+//    ____     _ _
+//   / ___|___| | |
+//  | |   / _ \ | |
+//  | |__|  __/ | |
+//   \____\___|_|_|
+// Multi-machine runtime: one process drives a whole cell. Every program on
+// the command line gets its own machine, FSM and CSV output (<id>.csv);
+// instances are sharded over a pool of worker threads, each multiplexing
+// per-machine tick timers (timerfd) and feedback sockets through epoll, so
+// that nothing spins and CPU use follows the actual work.
+// Programs run at once (no keypress) and the process exits when all are
+// done. With more than one program, machine topics are tagged with the
+// instance id (see machine_set_id()).
+// Usage: c-cnc-cell [-w workers] [-c settings.ini] program.g...
+#include "../defines.h"
+#include "../machine.h"
+#include "../fsm.h"
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+//
+// preprocessor macros and constants
+#define INI_FILE "settings.ini"
+#define MAX_EVENTS 64
+#define EV_TIMER 0
+#define EV_SOCKET 1
+// epoll user data: instance index and event kind
+#define EV_TAG(i, kind) (((uint64_t)(i) << 1) | (kind))
+
+// Custom types
+typedef struct {
+  char id[16];
+  ccnc_state_data_t data;
+  ccnc_state_t state;
+  int timer_fd;            // tick timer, period tq / rt_pacing
+  int sock_fd;             // feedback socket, or -1
+  uint64_t ticks;          // FSM steps run
+  uint64_t missed;         // timer expirations missed (overruns)
+} instance_t;
+
+typedef struct {
+  pthread_t tid;
+  instance_t *inst;        // all instances (shared, read only)
+  size_t n, first, stride; // this worker runs first, first+stride, ...
+  size_t running;
+  data_t cpu;              // thread CPU time (s)
+} worker_t;
+
+static int instance_start(instance_t *in, const char *ini, const char *prog, size_t i, size_t n);
+static int instance_arm(instance_t *in, int epfd, size_t i);
+static void instance_stop(instance_t *in, int epfd);
+static void *worker_run(void *arg);
+
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_|_| |_|
+//
+int main(int argc, char *const argv[]) {
+  const char *ini = INI_FILE;
+  instance_t *inst;
+  worker_t *workers;
+  size_t n, n_workers = 1, i;
+  uint64_t ticks = 0, missed = 0;
+  data_t cpu = 0;
+  int opt, failed = 0;
+
+  while ((opt = getopt(argc, argv, "w:c:h")) != -1) {
+    switch (opt) {
+      case 'w': n_workers = atol(optarg); break;
+      case 'c': ini = optarg; break;
+      default:
+        eprintf("Usage: %s [-w workers] [-c settings.ini] program.g...\n", argv[0]);
+        return 1;
+    }
+  }
+  n = argc - optind;
+  if (n == 0) {
+    eprintf("Usage: %s [-w workers] [-c settings.ini] program.g...\n", argv[0]);
+    return 1;
+  }
+  if (n_workers < 1) n_workers = 1;
+  if (n_workers > n) n_workers = n;
+  inst = (instance_t *)calloc(n, sizeof(instance_t));
+  workers = (worker_t *)calloc(n_workers, sizeof(worker_t));
+  if (!inst || !workers) {
+    perror("Could not allocate instances");
+    return 1;
+  }
+
+  // connecting and parsing happen here, one instance at a time, so that
+  // workers only ever run realtime ticks
+  for (i = 0; i < n; i++) {
+    if (instance_start(&inst[i], ini, argv[optind + i], i, n)) failed++;
+  }
+  eprintf("Running %zu machines on %zu workers\n", n - failed, n_workers);
+  for (i = 0; i < n_workers; i++) {
+    workers[i] = (worker_t){.inst = inst, .n = n, .first = i, .stride = n_workers};
+    if (pthread_create(&workers[i].tid, NULL, worker_run, &workers[i])) {
+      perror("Could not start worker");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < n_workers; i++) {
+    pthread_join(workers[i].tid, NULL);
+    cpu += workers[i].cpu;
+  }
+
+  eprintf("id,ticks,missed\n");
+  for (i = 0; i < n; i++) {
+    eprintf("%s,%" PRIu64 ",%" PRIu64 "\n", inst[i].id, inst[i].ticks, inst[i].missed);
+    ticks += inst[i].ticks;
+    missed += inst[i].missed;
+  }
+  eprintf("Total: %" PRIu64 " ticks, %" PRIu64 " missed, %.3f s CPU (%.1f us per tick)\n",
+    ticks, missed, cpu, ticks > 0 ? cpu * 1E6 / ticks : 0);
+  free(inst);
+  free(workers);
+  return failed ? 2 : 0;
+}
+
+
+//   ____        __ _       _ _   _
+//  |  _ \  ___ / _(_)_ __ (_) |_(_) ___  _ __  ___
+//  | | | |/ _ \ |_| | '_ \| | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/  _| | | | | | |_| | (_) | | | \__ \
+//  |____/ \___|_| |_|_| |_|_|\__|_|\___/|_| |_|___/
+//
+
+// Run the init state: create, connect, parse
+static int instance_start(instance_t *in, const char *ini, const char *prog, size_t i, size_t n) {
+  char csv[32];
+  snprintf(in->id, sizeof(in->id), "m%03zu", i);
+  snprintf(csv, sizeof(csv), "%s.csv", in->id);
+  in->timer_fd = in->sock_fd = -1;
+  in->data = (ccnc_state_data_t){
+    .ini_file = (char *)ini,
+    .prog_file = prog,
+    .machine_id = n > 1 ? in->id : NULL,
+    .autostart = 1,
+    .out = fopen(csv, "w")
+  };
+  if (!in->data.out) {
+    perror("Could not open CSV output");
+    in->state = CCNC_STATE_STOP;
+    return 1;
+  }
+  eprintf("[%s] %s -> %s\n", in->id, prog, csv);
+  in->state = ccnc_run_state(CCNC_STATE_INIT, &in->data);
+  if (in->state == CCNC_STATE_STOP) {
+    ccnc_run_state(in->state, &in->data);
+    fclose(in->data.out);
+    return 1;
+  }
+  return 0;
+}
+
+// Create the tick timer and register it and the feedback socket
+static int instance_arm(instance_t *in, int epfd, size_t i) {
+  machine_t *m = in->data.machine;
+  data_t pacing = machine_rt_pacing(m) > 0 ? machine_rt_pacing(m) : 1;
+  uint64_t period = machine_tq(m) * 1E9 / pacing;
+  struct itimerspec its = {
+    .it_interval = {.tv_sec = period / 1000000000, .tv_nsec = period % 1000000000},
+    .it_value = {.tv_sec = period / 1000000000, .tv_nsec = period % 1000000000}
+  };
+  struct epoll_event ev = {.events = EPOLLIN};
+  in->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  if (in->timer_fd < 0 || timerfd_settime(in->timer_fd, 0, &its, NULL)) {
+    perror("Could not create tick timer");
+    return 1;
+  }
+  ev.data.u64 = EV_TAG(i, EV_TIMER);
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, in->timer_fd, &ev)) {
+    perror("Could not watch tick timer");
+    return 1;
+  }
+  // without a socket, feedback is only processed at ticks
+  in->sock_fd = machine_fd(m);
+  if (in->sock_fd >= 0) {
+    ev.data.u64 = EV_TAG(i, EV_SOCKET);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, in->sock_fd, &ev)) {
+      perror("Could not watch machine socket");
+      in->sock_fd = -1;
+    }
+  }
+  return 0;
+}
+
+// Run the stop state and release the timer
+static void instance_stop(instance_t *in, int epfd) {
+  if (in->sock_fd >= 0) epoll_ctl(epfd, EPOLL_CTL_DEL, in->sock_fd, NULL);
+  if (in->timer_fd >= 0) close(in->timer_fd);
+  in->sock_fd = in->timer_fd = -1;
+  ccnc_run_state(CCNC_STATE_STOP, &in->data);
+  in->state = CCNC_STATE_STOP;
+  fclose(in->data.out);
+}
+
+static void *worker_run(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  struct epoll_event events[MAX_EVENTS];
+  struct timespec cpu;
+  instance_t *in;
+  uint64_t expirations;
+  size_t i;
+  int epfd = epoll_create1(0), k, n_ev;
+
+  if (epfd < 0) {
+    perror("Could not create epoll instance");
+    return NULL;
+  }
+  for (i = w->first; i < w->n; i += w->stride) {
+    in = &w->inst[i];
+    if (in->state == CCNC_STATE_STOP) continue;
+    if (instance_arm(in, epfd, i)) {
+      instance_stop(in, epfd);
+      continue;
+    }
+    w->running++;
+  }
+
+  while (w->running > 0) {
+    n_ev = epoll_wait(epfd, events, MAX_EVENTS, -1);
+    if (n_ev < 0) {
+      if (errno == EINTR) continue;
+      perror("epoll_wait");
+      break;
+    }
+    for (k = 0; k < n_ev; k++) {
+      in = &w->inst[events[k].data.u64 >> 1];
+      if (in->state == CCNC_STATE_STOP) continue;
+      if ((events[k].data.u64 & 1) == EV_SOCKET) {
+        machine_listen_update(in->data.machine);
+        continue;
+      }
+      // tick: one FSM step, however many periods elapsed
+      if (read(in->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        continue;
+      in->missed += expirations - 1;
+      in->ticks++;
+      in->state = ccnc_run_state(in->state, &in->data);
+      if (in->state == CCNC_STATE_STOP) {
+        instance_stop(in, epfd);
+        w->running--;
+      }
+    }
+  }
+  close(epfd);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+  w->cpu = cpu.tv_sec + cpu.tv_nsec / 1E9;
+  return NULL;
+}
@@ -4,26 +4,191 @@
 #include "../block.h"
 #include "../point.h"
 #include "../fsm.h"
+#include "../ticker.h"
+#include "../rt.h"
+#include "../inic.h"
+#include "../timeline.h"
+#ifdef __linux__
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#endif
 
 #define eprintf(...) fprintf(stderr, __VA_ARGS__)
 
+static int run_events(ccnc_state_t *state, ccnc_state_data_t *data);
+
 #if 1
 int main(int argc, char const *argv[]) {
   ccnc_state_data_t state_data = {
     .ini_file = "settings.ini",
     .prog_file = argv[1],
+    // further files are run as a job queue
+    .queue = argv + 2,
+    .queue_len = argc > 2 ? argc - 2 : 0,
     .machine = NULL,
     .prog = NULL
   };
   ccnc_state_t cur_state = CCNC_STATE_INIT;
-  do {
+  // tick timer, with the lateness of each wakeup
+  ticker_t *ticker = NULL;
+  rt_t *rt = NULL;
+  int threaded = 0, events = 0, timing = 0, timeline_events;
+  char trace_file[1024], timeline_file[1024] = "";
+  void *ini;
+  size_t i, j;
+  // optional FSM instrumentation, enabled before init so that it is timed
+  // too, and trace output
+  if ((ini = ini_init(state_data.ini_file))) {
+    ini_get_int(ini, "C-CNC", "fsm_timing", &timing);
+    // full program listing on load, instead of a summary
+    if (ini_get_int(ini, "C-CNC", "print_program", &state_data.print_program))
+      state_data.print_program = 0;
+    // binary trace (see trace2csv) in place of the CSV on stdout
+    if (!ini_get_char(ini, "C-CNC", "trace_file", trace_file, sizeof(trace_file)) &&
+        trace_file[0]) {
+      state_data.trace_file = trace_file;
+    }
+    // Chrome trace JSON timeline of FSM steps and network events
+    ini_get_char(ini, "C-CNC", "timeline_file", timeline_file, sizeof(timeline_file));
+    if (ini_get_int(ini, "C-CNC", "timeline_events", &timeline_events))
+      timeline_events = 200000;
+    ini_free(ini);
+  }
+  if (timing && (state_data.timing = fsm_timing_new(CCNC_NUM_STATES, ccnc_state_names))) {
+    for (i = 0; i < CCNC_NUM_STATES; i++) {
+      for (j = 0; j < CCNC_NUM_STATES; j++) {
+        if (ccnc_transition_table[i][j]) fsm_timing_track(state_data.timing, i, j);
+      }
+    }
+  }
+  if (timeline_file[0] && timeline_events > 0 && !timeline_start(timeline_events)) {
+    timeline_thread_name("controller");
+  }
+  // init creates the machine and loads the program: only then everything
+  // the loop needs is allocated, and the realtime setup can take place
+  cur_state = ccnc_run_state(cur_state, &state_data);
+  if (cur_state != CCNC_STATE_STOP) {
+    threaded = machine_threaded(state_data.machine);
+    events = machine_event_loop(state_data.machine);
+    if (state_data.timing && machine_rt_pacing(state_data.machine) > 0) {
+      fsm_timing_set_budget(state_data.timing,
+        machine_tq(state_data.machine) * 1E9 / machine_rt_pacing(state_data.machine));
+    }
+    rt = rt_new(state_data.ini_file);
+    if (rt) rt_enter(rt);
+  }
+  // rt_pacing 0 means no pacing at all
+  if (cur_state != CCNC_STATE_STOP && machine_rt_pacing(state_data.machine) > 0) {
+    // if the event loop cannot start, fall back to the ticker
+    if (!events || run_events(&cur_state, &state_data)) {
+      ticker = ticker_new(
+        machine_tq(state_data.machine) * 1E9 / machine_rt_pacing(state_data.machine),
+        machine_tick_spin(state_data.machine) * 1E3);
+    }
+  }
+  while (cur_state != CCNC_STATE_STOP) {
+    if (ticker) ticker_wait(ticker);
     cur_state = ccnc_run_state(cur_state, &state_data);
-    wait_next(machine_tq(state_data.machine) * 1E9 / machine_rt_pacing(state_data.machine));
-  } while (cur_state != CCNC_STATE_STOP);
+  }
+  if (rt) {
+    rt_report(rt, stderr);
+    rt_free(rt);
+  }
+  if (ticker) {
+    eprintf("Tick lateness (%s network loop, %.0f us spin), %" PRIu64 " overruns\n",
+      threaded ? "threaded" : "inline", ticker_spin(ticker) / 1E3,
+      ticker_overruns(ticker));
+    histogram_print(ticker_lateness(ticker), stderr, "Tick lateness", 1E3, "us");
+    ticker_free(ticker);
+  }
   ccnc_run_state(cur_state, &state_data);
+  if (state_data.timing) {
+    fsm_timing_print(state_data.timing, stderr);
+    fsm_timing_free(state_data.timing);
+  }
+  if (timeline_enabled()) {
+    timeline_write(timeline_file);
+  }
   return 0;
 }
 
+#ifdef __linux__
+// Event-driven loop: a single poll() waits for the tick timer and for the
+// machine socket, both readable (feedback is processed as soon as it
+// arrives) and, when the backend has data pending, writable. One FSM step
+// per timer wakeup: missed periods are counted as overruns, not recovered.
+// Returns 0 once the FSM reached the stop state, 1 if the loop could not
+// run (the caller then falls back to the ticker)
+static int run_events(ccnc_state_t *state, ccnc_state_data_t *data) {
+  machine_t *m = data->machine;
+  uint64_t period = machine_tq(m) * 1E9 / machine_rt_pacing(m);
+  uint64_t deadline = now_ns() + period, expirations, now, overruns = 0;
+  struct itimerspec its = {
+    .it_interval = {.tv_sec = period / 1000000000, .tv_nsec = period % 1000000000},
+    .it_value = {.tv_sec = deadline / 1000000000, .tv_nsec = deadline % 1000000000}
+  };
+  struct pollfd pfd[2];
+  histogram_t *lateness;
+  int dead_fd = -1; // socket that hung up, left out until it is replaced
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  if (tfd < 0 || timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL)) {
+    perror("Could not create tick timer");
+    if (tfd >= 0) close(tfd);
+    return 1;
+  }
+  lateness = histogram_new();
+  while (*state != CCNC_STATE_STOP) {
+    pfd[0] = (struct pollfd){.fd = tfd, .events = POLLIN};
+    // the socket may change across reconnections: ask every time
+    pfd[1] = (struct pollfd){
+      .fd = machine_fd(m),
+      .events = POLLIN | (machine_want_write(m) ? POLLOUT : 0)
+    };
+    if (pfd[1].fd == dead_fd) pfd[1].fd = -1;
+    now = timeline_enabled() ? now_ns() : 0;
+    if (poll(pfd, pfd[1].fd >= 0 ? 2 : 1, -1) < 0) {
+      if (errno == EINTR) continue; // SIGINT is handled by the FSM
+      perror("poll");
+      close(tfd);
+      histogram_free(lateness);
+      return 1;
+    }
+    if (now) timeline_span("tick", "poll", now, now_ns(), NULL, 0);
+    if (pfd[1].fd >= 0 && pfd[1].revents) {
+      machine_listen_update(m);
+      // a hangup or an error stays pending: stop polling that socket, or
+      // poll() would return at once forever
+      if (pfd[1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        eprintf("Machine socket closed or in error, no longer polled\n");
+        dead_fd = pfd[1].fd;
+      }
+    }
+    if (!(pfd[0].revents & POLLIN) ||
+        read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+      continue;
+    }
+    now = now_ns();
+    histogram_add(lateness, now > deadline ? now - deadline : 0);
+    deadline += expirations * period;
+    overruns += expirations - 1;
+    *state = ccnc_run_state(*state, data);
+  }
+  close(tfd);
+  eprintf("Tick lateness (event loop), %" PRIu64 " overruns\n", overruns);
+  histogram_print(lateness, stderr, "Tick lateness", 1E3, "us");
+  histogram_free(lateness);
+  return 0;
+}
+#else
+static int run_events(ccnc_state_t *state, ccnc_state_data_t *data) {
+  eprintf("Event loop not supported on this platform\n");
+  return 1;
+}
+#endif
+
 
 
 #else
@@ -67,7 +232,7 @@ int main(int argc, char const *argv[]) {
       lambda = block_lambda(b, t, &f);
       sp = block_interpolate(b, lambda);
       if (!sp) continue;
-      printf("%lu,%f,%f,%f,%f,%f,%f,%f,%f\n", block_n(b), t, tt,
+      printf("%zu,%f,%f,%f,%f,%f,%f,%f,%f\n", block_n(b), t, tt,
         lambda, lambda * block_length(b), f,
         point_x(sp), point_y(sp), point_z(sp));
       machine_sync(machine);
@@ -0,0 +1,242 @@
+//   _____     _
+//  | ____|___| |__   ___
+//  |  _| / __| '_ \ / _ \
+//  | |__| (__| | | | (_) |
+//  |_____\___|_| |_|\___/
+// Machine stand-in: echoes every setpoint back as actual position, with
+// zero positioning error. Useful for testing and benchmarking transports
+// without the MATLAB/Simulink models.
+// Usage: machine_echo [mqtt|shm|dgram] (default: transport in settings.ini)
+#include "../defines.h"
+#include "../inic.h"
+#include "../shm_link.h"
+#include "../dgram_link.h"
+#include <mosquitto.h>
+#include <mqtt_protocol.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+//
+// preprocessor macros and constants
+#define BUFLEN 1024
+#define INI_FILE "settings.ini"
+
+// Custom types
+typedef struct {
+  char transport[BUFLEN];
+  char broker_addr[BUFLEN];
+  int broker_port;
+  char pub_topic[BUFLEN];    // controller publishes setpoints here
+  char status_topic[BUFLEN]; // base topic for position and error
+  char shm_name[BUFLEN];
+  dgram_family_t dgram_family;
+  char dgram_addr[BUFLEN];   // host (udp) or path prefix (unix)
+  int dgram_port;
+  char buffer[BUFLEN];
+  uint64_t count;
+} userdata_t;
+
+static int run_mqtt(userdata_t *ud);
+static int run_shm(userdata_t *ud);
+static int run_dgram(userdata_t *ud);
+static void on_connect(struct mosquitto *mqt, void *obj, int rc);
+static void on_message(struct mosquitto *mqt, void *obj, const struct mosquitto_message *msg);
+
+// global variable for controlling the main loop
+static int _running = 1;
+static void sig_handler(int signal) {
+  if (signal == SIGINT) _running = 0;
+}
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  userdata_t ud = {
+    .transport = "mqtt",
+    .broker_addr = "localhost",
+    .broker_port = 1883,
+    .pub_topic = "c-cnc/setpoint",
+    .status_topic = "c-cnc/status/",
+    .shm_name = "/c-cnc",
+    .dgram_family = DGRAM_UDP,
+    .dgram_addr = "127.0.0.1",
+    .dgram_port = 9100,
+    .count = 0
+  };
+  void *ini = ini_init(INI_FILE);
+  char family[BUFLEN];
+  int rv;
+  char *hash;
+
+  if (!ini) {
+    eprintf("Error opening INI file\n");
+    return 1;
+  }
+  ini_get_char(ini, "MQTT", "broker_addr", ud.broker_addr, BUFLEN);
+  ini_get_int(ini, "MQTT", "broker_port", &ud.broker_port);
+  ini_get_char(ini, "MQTT", "pub_topic", ud.pub_topic, BUFLEN);
+  ini_get_char(ini, "MQTT", "sub_topic", ud.status_topic, BUFLEN);
+  // optional fields
+  if (ini_get_char(ini, "C-CNC", "transport", ud.transport, BUFLEN))
+    strcpy(ud.transport, "mqtt");
+  if (ini_get_char(ini, "SHM", "name", ud.shm_name, BUFLEN))
+    strcpy(ud.shm_name, "/c-cnc");
+  if (!ini_get_char(ini, "DGRAM", "family", family, BUFLEN) &&
+      strcmp(family, "unix") == 0) {
+    ud.dgram_family = DGRAM_UNIX;
+    if (ini_get_char(ini, "DGRAM", "path", ud.dgram_addr, BUFLEN))
+      strcpy(ud.dgram_addr, "/tmp/c-cnc");
+  }
+  else {
+    if (ini_get_char(ini, "DGRAM", "host", ud.dgram_addr, BUFLEN))
+      strcpy(ud.dgram_addr, "127.0.0.1");
+    if (ini_get_int(ini, "DGRAM", "port", &ud.dgram_port))
+      ud.dgram_port = 9100;
+  }
+  ini_free(ini);
+  // status topic is the subscription topic without the trailing wildcard
+  if ((hash = strchr(ud.status_topic, '#'))) *hash = '\0';
+  if (argc > 1) {
+    strncpy(ud.transport, argv[1], BUFLEN - 1);
+  }
+
+  signal(SIGINT, sig_handler);
+  eprintf("Echoing setpoints over %s, press Ctrl-C to stop\n", ud.transport);
+  if (strcmp(ud.transport, "shm") == 0) {
+    rv = run_shm(&ud);
+  }
+  else if (strcmp(ud.transport, "dgram") == 0) {
+    rv = run_dgram(&ud);
+  }
+  else if (strcmp(ud.transport, "mqtt") == 0) {
+    rv = run_mqtt(&ud);
+  }
+  else {
+    eprintf("Unsupported transport %s\n", ud.transport);
+    rv = 1;
+  }
+  eprintf("Echoed %" PRIu64 " setpoints\n", ud.count);
+  return rv;
+}
+
+
+//   ____        __ _       _ _   _
+//  |  _ \  ___ / _(_)_ __ (_) |_(_) ___  _ __  ___
+//  | | | |/ _ \ |_| | '_ \| | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/  _| | | | | | |_| | (_) | | | \__ \
+//  |____/ \___|_| |_|_| |_|_|\__|_|\___/|_| |_|___/
+//
+
+static int run_shm(userdata_t *ud) {
+  shm_msg_t msg;
+  shm_link_t *link = shm_link_open(ud->shm_name, SHM_MACHINE);
+  if (!link) return 1;
+  while (_running) {
+    // wake up at least every 100 ms to check for SIGINT
+    if (!shm_link_wait(link, &msg, 100000000)) continue;
+    msg.error = 0;
+    shm_link_send(link, &msg);
+    ud->count++;
+  }
+  shm_link_close(link);
+  return 0;
+}
+
+static int run_dgram(userdata_t *ud) {
+  dgram_msg_t msg;
+  dgram_stats_t st;
+  dgram_link_t *link = dgram_link_open(ud->dgram_family, ud->dgram_addr, ud->dgram_port, DGRAM_MACHINE);
+  if (!link) return 1;
+  while (_running) {
+    if (!dgram_link_wait(link, &msg, 100)) continue;
+    msg.error = 0;
+    dgram_link_send(link, &msg);
+    ud->count++;
+  }
+  dgram_link_stats(link, &st);
+  eprintf("Received %" PRIu64 " setpoints, %" PRIu64 " lost, %" PRIu64 " reordered, %" PRIu64 " duplicated\n",
+    st.received, st.lost, st.reordered, st.duplicated);
+  dgram_link_close(link);
+  return 0;
+}
+
+static int run_mqtt(userdata_t *ud) {
+  struct mosquitto *mqt;
+  mosquitto_lib_init();
+  mqt = mosquitto_new(NULL, 1, ud);
+  if (!mqt) {
+    perror("Could not create MQTT object");
+    return 1;
+  }
+  mosquitto_connect_callback_set(mqt, on_connect);
+  mosquitto_message_callback_set(mqt, on_message);
+  if (mosquitto_connect(mqt, ud->broker_addr, ud->broker_port, 60) != MOSQ_ERR_SUCCESS) {
+    perror("Error connecting to the broker");
+    return 2;
+  }
+  while (_running) {
+    if (mosquitto_loop(mqt, 100, 1) != MOSQ_ERR_SUCCESS) {
+      perror("mosquitto_loop error");
+      break;
+    }
+  }
+  mosquitto_disconnect(mqt);
+  mosquitto_destroy(mqt);
+  mosquitto_lib_cleanup();
+  return 0;
+}
+
+static void on_connect(struct mosquitto *mqt, void *obj, int rc) {
+  userdata_t *ud = (userdata_t *)obj;
+  if (rc != CONNACK_ACCEPTED) {
+    eprintf("-X Connection error: %s\n", mosquitto_connack_string(rc));
+    exit(EXIT_FAILURE);
+  }
+  eprintf("-> Connected to %s:%d\n", ud->broker_addr, ud->broker_port);
+  // also <pub_topic>/<id>, used by many machines sharing the broker (see
+  // machine_set_id())
+  char topic[BUFLEN + 4];
+  snprintf(topic, sizeof(topic), "%s/+", ud->pub_topic);
+  if (mosquitto_subscribe(mqt, NULL, ud->pub_topic, 0) != MOSQ_ERR_SUCCESS ||
+      mosquitto_subscribe(mqt, NULL, topic, 0) != MOSQ_ERR_SUCCESS) {
+    perror("Could not subscribe");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// payload is like
+// {"x":1.000000,"y":2.000000,"z":3.000000,"rapid":false,"seq":12,"t":3456}
+static void on_message(struct mosquitto *mqt, void *obj, const struct mosquitto_message *msg) {
+  userdata_t *ud = (userdata_t *)obj;
+  char topic[2 * BUFLEN + 16];
+  char *field, *id = msg->topic + strlen(ud->pub_topic);
+  data_t x, y, z;
+  uint64_t seq = 0, t = 0;
+  if (sscanf(msg->payload, "{\"x\":%lf,\"y\":%lf,\"z\":%lf", &x, &y, &z) != 3) {
+    eprintf("Malformed setpoint: %s\n", (char *)msg->payload);
+    return;
+  }
+  // echo back sequence number and timestamp, for latency measurement
+  if ((field = strstr(msg->payload, "\"seq\":"))) seq = strtoull(field + 6, NULL, 10);
+  if ((field = strstr(msg->payload, "\"t\":"))) t = strtoull(field + 4, NULL, 10);
+  snprintf(ud->buffer, BUFLEN, "%f,%f,%f,%" PRIu64 ",%" PRIu64, x, y, z, seq, t);
+  // reply under <status_topic>/<id>/ if the setpoint came with an id
+  if (*id == '/') id++;
+  snprintf(topic, sizeof(topic), "%s%s%sposition", ud->status_topic, id, *id ? "/" : "");
+  mosquitto_publish(mqt, NULL, topic, strlen(ud->buffer), ud->buffer, 0, 0);
+  snprintf(ud->buffer, BUFLEN, "0,%" PRIu64 ",%" PRIu64, seq, t);
+  snprintf(topic, sizeof(topic), "%s%s%serror", ud->status_topic, id, *id ? "/" : "");
+  mosquitto_publish(mqt, NULL, topic, strlen(ud->buffer), ud->buffer, 0, 0);
+  ud->count++;
+}
@@ -4,8 +4,24 @@
 //   ___) | |_| | |  __/\__ \__ \ | ||  __/\__ \ |_
 //  |____/ \__|_|  \___||___/___/  \__\___||___/\__|
 // MQTT Stress test
+// Setpoint load generator for capacity planning of the broker: N simulated
+// machines publish setpoints at a given rate, and the round trip to the
+// echoed status is measured. Run machine_echo (mqtt) to close the loop.
+// Usage: mqtt_stress [-n machines] [-r rate_hz] [-d duration_s]
+//                    [-p program.g] [-o results.csv] [-t transport]
+// With -p, the setpoint stream of the program is replayed (once, unless a
+// duration is given) instead of a synthetic circle. -t runs a single
+// machine over another transport, for comparison.
 #include "../defines.h"
 #include "../inic.h"
+#include "../machine.h"
+#include "../program.h"
+#include "../block.h"
+#include "../point.h"
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <inttypes.h>
 
 
 //   ____            _                 _   _                 
@@ -15,9 +31,30 @@
 //  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
 // 
 // preprocessor macros and constants
-
+#define INI_FILE "settings.ini"
+#define DRAIN_TIME 1000000000 // ns to wait for late replies
+#define RADIUS 10.0           // synthetic circle radius (mm)
+#define PERIOD_SAMPLES 1000   // synthetic circle samples per revolution
+#define POLL_PERIOD 20000     // ns between checks for replies (resolution)
 
 // Custom types
+typedef struct {
+  data_t x, y, z;
+  int rapid;
+} sample_t;
+
+typedef struct {
+  sample_t *samples;
+  size_t len, cap;
+} stream_t;
+
+static int stream_push(stream_t *s, data_t x, data_t y, data_t z, int rapid);
+static int stream_synthetic(stream_t *s, const point_t *zero);
+static int stream_program(stream_t *s, const char *file);
+static void poll_until(machine_t **machines, size_t n, uint64_t deadline);
+static data_t cpu_time(void);
+static void print_row(FILE *out, const char *name, const histogram_t *lat,
+  uint64_t sent, data_t elapsed, data_t cpu_per_msg);
 
 
 //                   _
@@ -26,7 +63,262 @@
 //  | | | | | | (_| | | | | |
 //  |_| |_| |_|\__,_|_|_| |_|
 //
-int main(int argc, char const *argv[]) {
-  // code here
+int main(int argc, char *const argv[]) {
+  size_t n_machines = 1, connected = 0, i, k;
+  data_t rate = 0, duration = 0, elapsed, cpu;
+  const char *prog_file = NULL, *out_file = NULL, *transport = "mqtt";
+  machine_t **machines = NULL;
+  uint64_t *sent = NULL, total_sent = 0, t0, steps, step_ns;
+  histogram_t *all = histogram_new();
+  stream_t stream = {0};
+  FILE *out = stdout;
+  char id[32];
+  int opt, rv = 0;
+
+  while ((opt = getopt(argc, argv, "n:r:d:p:o:t:h")) != -1) {
+    switch (opt) {
+      case 'n': n_machines = atol(optarg); break;
+      case 'r': rate = atof(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      case 'p': prog_file = optarg; break;
+      case 'o': out_file = optarg; break;
+      case 't': transport = optarg; break;
+      default:
+        eprintf("Usage: %s [-n machines] [-r rate_hz] [-d duration_s] "
+          "[-p program.g] [-o results.csv] [-t transport]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (n_machines < 1) {
+    eprintf("Need at least one machine\n");
+    return 1;
+  }
+  if (n_machines > 1 && strcmp(transport, "mqtt") != 0) {
+    eprintf("Only mqtt supports many machines\n");
+    return 1;
+  }
+
+  // create and connect the machines: with more than one, each gets its own
+  // topics, so that the echoes do not cross
+  machines = (machine_t **)calloc(n_machines, sizeof(machine_t *));
+  sent = (uint64_t *)calloc(n_machines, sizeof(uint64_t));
+  if (!machines || !sent || !all) {
+    perror("Could not allocate machines");
+    return 1;
+  }
+  for (i = 0; i < n_machines; i++) {
+    machines[i] = machine_new(INI_FILE);
+    if (!machines[i]) {
+      eprintf("Error creating machine instance\n");
+      rv = 1;
+      goto cleanup;
+    }
+    if (machine_select_transport(machines[i], transport)) {
+      eprintf("Unknown transport %s\n", transport);
+      rv = 1;
+      goto cleanup;
+    }
+    if (n_machines > 1) {
+      snprintf(id, sizeof(id), "m%03zu", i);
+      machine_set_id(machines[i], id);
+    }
+    if (machine_connect(machines[i], NULL)) {
+      rv = 2;
+      goto cleanup;
+    }
+    connected++;
+    machine_listen_start(machines[i]);
+  }
+
+  // setpoint stream
+  if (prog_file) {
+    if (stream_program(&stream, prog_file)) {
+      rv = 1;
+      goto cleanup;
+    }
+    // replay once by default
+    if (duration <= 0) duration = stream.len / (rate > 0 ? rate : 1.0 / machine_tq(machines[0]));
+  }
+  else if (stream_synthetic(&stream, machine_zero(machines[0]))) {
+    rv = 1;
+    goto cleanup;
+  }
+  if (rate <= 0) rate = 1.0 / machine_tq(machines[0]);
+  if (duration <= 0) duration = 10;
+  step_ns = 1E9 / rate;
+  steps = duration * rate;
+  eprintf("Publishing %" PRIu64 " setpoints at %.1f Hz to each of %zu machines over %s (%s)\n",
+    steps, rate, n_machines, transport, prog_file ? prog_file : "synthetic");
+
+  // publishing loop: every tick, each machine gets the next setpoint
+  cpu = cpu_time();
+  t0 = now_ns();
+  for (k = 0; k < steps; k++) {
+    const sample_t *s = &stream.samples[k % stream.len];
+    for (i = 0; i < n_machines; i++) {
+      point_t *sp = machine_setpoint(machines[i]);
+      point_set_xyz(sp, s->x, s->y, s->z);
+      if (machine_sync(machines[i], s->rapid) == 0) sent[i]++;
+    }
+    poll_until(machines, n_machines, t0 + (k + 1) * step_ns);
+  }
+  elapsed = (now_ns() - t0) / 1E9;
+  // late replies still count as received
+  poll_until(machines, n_machines, now_ns() + DRAIN_TIME);
+  cpu = cpu_time() - cpu;
+
+  // results: one row per machine, plus the aggregate
+  if (out_file && !(out = fopen(out_file, "w"))) {
+    perror("Could not open output file");
+    out = stdout;
+  }
+  fprintf(out, "machine,sent,acked,dropped,rate_hz,min_us,p50_us,p99_us,p999_us,max_us,cpu_us_per_msg\n");
+  for (i = 0; i < n_machines; i++) {
+    snprintf(id, sizeof(id), "m%03zu", i);
+    print_row(out, id, machine_latency(machines[i]), sent[i], elapsed, -1);
+    histogram_merge(all, machine_latency(machines[i]));
+    total_sent += sent[i];
+  }
+  print_row(out, "all", all, total_sent, elapsed,
+    total_sent > 0 ? cpu * 1E6 / total_sent : 0);
+  if (out != stdout) {
+    fclose(out);
+    eprintf("Results written to %s\n", out_file);
+  }
+  histogram_print(all, stderr, "Round trip", 1E3, "us");
+
+cleanup:
+  for (i = 0; i < n_machines; i++) {
+    if (!machines[i]) continue;
+    if (i < connected) {
+      // already reported above
+      machine_stats_reset(machines[i]);
+      machine_listen_stop(machines[i]);
+      machine_disconnect(machines[i]);
+    }
+    machine_free(machines[i]);
+  }
+  free(machines);
+  free(sent);
+  free(stream.samples);
+  histogram_free(all);
+  return rv;
+}
+
+
+//   ____        __ _       _ _   _
+//  |  _ \  ___ / _(_)_ __ (_) |_(_) ___  _ __  ___
+//  | | | |/ _ \ |_| | '_ \| | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/  _| | | | | | |_| | (_) | | | \__ \
+//  |____/ \___|_| |_|_| |_|_|\__|_|\___/|_| |_|___/
+//
+
+static int stream_push(stream_t *s, data_t x, data_t y, data_t z, int rapid) {
+  if (s->len == s->cap) {
+    size_t cap = s->cap ? s->cap * 2 : 1024;
+    sample_t *p = (sample_t *)realloc(s->samples, cap * sizeof(sample_t));
+    if (!p) {
+      perror("Could not grow setpoint stream");
+      return 1;
+    }
+    s->samples = p;
+    s->cap = cap;
+  }
+  s->samples[s->len++] = (sample_t){.x = x, .y = y, .z = z, .rapid = rapid};
+  return 0;
+}
+
+// a circle around the machine zero
+static int stream_synthetic(stream_t *s, const point_t *zero) {
+  size_t i;
+  for (i = 0; i < PERIOD_SAMPLES; i++) {
+    data_t a = 2 * M_PI * i / PERIOD_SAMPLES;
+    if (stream_push(s, point_x(zero) + RADIUS * cos(a),
+        point_y(zero) + RADIUS * sin(a), point_z(zero), 0))
+      return 1;
+  }
   return 0;
 }
+
+// the same setpoints the controller would send for the program: one per
+// rapid block, one per sampling time in interpolated blocks
+static int stream_program(stream_t *s, const char *file) {
+  machine_t *cfg = machine_new(INI_FILE);
+  program_t *p = program_new(file);
+  block_t *b;
+  point_t *sp;
+  data_t t, tq, lambda, f;
+  int rv = 0;
+  if (!cfg || !p || program_parse(p, cfg) == EXIT_FAILURE) {
+    eprintf("Could not parse program %s\n", file);
+    rv = 1;
+    goto end;
+  }
+  tq = machine_tq(cfg);
+  while ((b = program_next(p)) && !rv) {
+    if (block_type(b) == RAPID) {
+      sp = block_target(b);
+      rv = stream_push(s, point_x(sp), point_y(sp), point_z(sp), 1);
+      continue;
+    }
+    if (block_type(b) > ARC_CCW) continue;
+    // see c-cnc.c for the tq/2 tolerance
+    for (t = 0; t <= block_dt(b) + tq / 2.0 && !rv; t += tq) {
+      lambda = block_lambda(b, t, &f);
+      sp = block_interpolate(b, lambda);
+      if (!sp) continue;
+      rv = stream_push(s, point_x(sp), point_y(sp), point_z(sp), 0);
+    }
+  }
+  if (!rv && s->len == 0) {
+    eprintf("Program %s has no motion\n", file);
+    rv = 1;
+  }
+  if (!rv) eprintf("Loaded %zu setpoints from %s\n", s->len, file);
+end:
+  if (p) program_free(p);
+  if (cfg) machine_free(cfg);
+  return rv;
+}
+
+// process replies until deadline (ns, see now_ns()). Unlike wait_next(),
+// this sleeps between checks rather than spinning, so that the CPU time
+// measured is mostly the one spent on messaging
+static void poll_until(machine_t **machines, size_t n, uint64_t deadline) {
+  uint64_t now;
+  size_t i;
+  struct timespec ts = {0};
+  while ((now = now_ns()) < deadline) {
+    for (i = 0; i < n; i++) {
+      machine_listen_update(machines[i]);
+    }
+    ts.tv_nsec = deadline - now < POLL_PERIOD ? deadline - now : POLL_PERIOD;
+    nanosleep(&ts, NULL);
+  }
+}
+
+// user + system time of the whole process (network threads included), in s
+static data_t cpu_time(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1E6 +
+         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1E6;
+}
+
+// negative cpu_per_msg leaves the field empty
+static void print_row(FILE *out, const char *name, const histogram_t *lat,
+  uint64_t sent, data_t elapsed, data_t cpu_per_msg) {
+  uint64_t acked = histogram_count(lat);
+  fprintf(out, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.1f,", name, sent, acked,
+    sent > acked ? sent - acked : 0, sent / elapsed);
+  if (acked > 0) {
+    fprintf(out, "%.1f,%.1f,%.1f,%.1f,%.1f,", histogram_min(lat) / 1E3,
+      histogram_percentile(lat, 50) / 1E3, histogram_percentile(lat, 99) / 1E3,
+      histogram_percentile(lat, 99.9) / 1E3, histogram_max(lat) / 1E3);
+  }
+  else {
+    fprintf(out, ",,,,,");
+  }
+  if (cpu_per_msg >= 0) fprintf(out, "%.2f", cpu_per_msg);
+  fprintf(out, "\n");
+}
@@ -0,0 +1,63 @@
+//   ____                        _ _               _           ____ ______     __
+//  |  _ \ ___  ___ ___  _ __ __| (_)_ __   __ _  | |_ ___    / ___/ ___\ \   / /
+//  | |_) / _ \/ __/ _ \| '__/ _` | | '_ \ / _` | | __/ _ \  | |   \___ \\ \ / /
+//  |  _ <  __/ (_| (_) | | | (_| | | | | | (_| | | || (_) | | |___ ___) |\ V /
+//  |_| \_\___|\___\___/|_|  \__,_|_|_| |_|\__, |  \__\___/   \____|____/  \_/
+//                                         |___/
+// Convert a flight recorder dump (see recorder.h and [RECORDER] in
+// settings.ini) to CSV, oldest step first. Times are in seconds, the step
+// duration in microseconds.
+// Usage: rec2csv <dump file> [csv file] (default: stdout)
+#include "../defines.h"
+#include "../recorder.h"
+#include "../fsm.h"
+#include <inttypes.h>
+
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  FILE *in, *out = stdout;
+  rec_header_t h;
+  rec_entry_t e;
+  uint64_t i;
+
+  if (argc < 2) {
+    eprintf("Usage: %s <dump file> [csv file]\n", argv[0]);
+    return 1;
+  }
+  if (!(in = fopen(argv[1], "rb"))) {
+    perror("Could not open dump file");
+    return 2;
+  }
+  if (fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, "CCNCREC1", 8) ||
+      h.record_size != sizeof(rec_entry_t) || h.reason > REC_CRASH) {
+    eprintf("%s is not a flight recorder dump of this build\n", argv[1]);
+    fclose(in);
+    return 2;
+  }
+  if (argc > 2 && !(out = fopen(argv[2], "w"))) {
+    perror("Could not create CSV file");
+    fclose(in);
+    return 2;
+  }
+  eprintf("Dumped on %s", rec_reason_names[h.reason]);
+  if (h.reason == REC_CRASH) eprintf(" (signal %u)", h.signal);
+  eprintf(": last %" PRIu64 " of %" PRIu64 " steps, tq = %g s\n", h.records, h.total, h.tq);
+  fprintf(out, "time,duration,state,next,n,t_tot,sp_x,sp_y,sp_z,x,y,z,error\n");
+  for (i = 0; i < h.records && fread(&e, sizeof(e), 1, in) == 1; i++) {
+    fprintf(out, "%.9f,%.3f,%s,%s,%" PRIu64 ",%f,%f,%f,%f,%f,%f,%f,%f\n",
+      e.time / 1E9, e.duration / 1E3,
+      e.state < CCNC_NUM_STATES ? ccnc_state_names[e.state] : "?",
+      e.next < CCNC_NUM_STATES ? ccnc_state_names[e.next] : "?",
+      e.block, e.t_tot, e.sp_x, e.sp_y, e.sp_z, e.x, e.y, e.z, e.error);
+  }
+  if (i < h.records) eprintf("Truncated dump: %" PRIu64 " records read\n", i);
+  if (out != stdout) fclose(out);
+  fclose(in);
+  return 0;
+}
@@ -0,0 +1,72 @@
+//   _____ _      _      _                     _
+//  |_   _(_) ___| | __ | |__   ___ _ __   ___| |__
+//    | | | |/ __| |/ / | '_ \ / _ \ '_ \ / __| '_ \
+//    | | | | (__|   <  | |_) |  __/ | | | (__| | | |
+//    |_| |_|\___|_|\_\ |_.__/ \___|_| |_|\___|_| |_|
+// Tick timer benchmark: for a range of spin thresholds, runs the ticker at
+// the given period and reports the wakeup lateness and the CPU time used.
+// The last row (spin = period) is a pure busy-wait, like the old
+// wait_next().
+// Usage: tick_bench [period_us] [ticks]
+#include "../defines.h"
+#include "../ticker.h"
+#include <sys/resource.h>
+
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+//
+// preprocessor macros and constants
+#define PERIOD 5000 // us, as tq in settings.ini
+#define TICKS 1000
+
+// spin thresholds to try (us); a negative value means the whole period
+static const data_t spins[] = {0, 10, 20, 50, 100, 200, -1};
+
+static data_t cpu_time() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1E6;
+}
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  data_t period = PERIOD, cpu, wall;
+  size_t i, k, n = TICKS;
+  uint64_t t0;
+  ticker_t *t;
+  char name[64];
+
+  if (argc > 1) period = atof(argv[1]);
+  if (argc > 2) n = atol(argv[2]);
+  if (period <= 0 || n == 0) {
+    eprintf("Usage: %s [period_us] [ticks]\n", argv[0]);
+    return 1;
+  }
+  eprintf("%zu ticks of %.0f us for each spin threshold\n", n, period);
+  for (i = 0; i < sizeof(spins) / sizeof(spins[0]); i++) {
+    t = ticker_new(period * 1E3, (spins[i] < 0 ? period : spins[i]) * 1E3);
+    if (!t) return 2;
+    cpu = cpu_time();
+    t0 = now_ns();
+    for (k = 0; k < n; k++) {
+      ticker_wait(t);
+    }
+    wall = (now_ns() - t0) / 1E9;
+    cpu = cpu_time() - cpu;
+    snprintf(name, sizeof(name), "spin %6.0f us, cpu %5.1f%%",
+      ticker_spin(t) / 1E3, cpu / wall * 100);
+    histogram_print(ticker_lateness(t), stdout, name, 1E3, "us");
+    ticker_free(t);
+  }
+  return 0;
+}
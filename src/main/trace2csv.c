@@ -0,0 +1,63 @@
+//   _____                     _           ____ ______     __
+//  |_   _| __ __ _  ___ ___  | |_ ___    / ___/ ___\ \   / /
+//    | || '__/ _` |/ __/ _ \ | __/ _ \  | |   \___ \\ \ / /
+//    | || | | (_| | (_|  __/ | || (_) | | |___ ___) |\ V /
+//    |_||_|  \__,_|\___\___|  \__\___/   \____|____/  \_/
+// Convert a binary trace (see trace.h and trace_file in settings.ini) to the
+// same CSV that c-cnc writes on stdout (with the columns it contains).
+// Usage: trace2csv <trace file> [csv file] (default: stdout)
+#include "../defines.h"
+#include "../trace.h"
+#include <inttypes.h>
+
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  trace_reader_t *r;
+  FILE *out = stdout;
+  data_t *cols[TRACE_COLUMNS] = {NULL}, row[TRACE_COLUMNS];
+  size_t c, i, k, rows, max_rows = 0;
+  int rv = 0;
+
+  if (argc < 2) {
+    eprintf("Usage: %s <trace file> [csv file]\n", argv[0]);
+    return 1;
+  }
+  if (!(r = trace_reader_open(argv[1]))) return 2;
+  if (argc > 2 && !(out = fopen(argv[2], "w"))) {
+    perror("Could not create CSV file");
+    trace_reader_close(r);
+    return 2;
+  }
+  for (i = 0; i < trace_reader_chunks(r); i++) {
+    if (trace_reader_chunk_rows(r, i) > max_rows)
+      max_rows = trace_reader_chunk_rows(r, i);
+  }
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    cols[c] = (data_t *)malloc((max_rows + 1) * sizeof(data_t));
+  }
+  trace_csv_header(out, trace_reader_columns(r));
+  for (i = 0; i < trace_reader_chunks(r); i++) {
+    if (trace_reader_chunk(r, i, cols)) {
+      rv = 3;
+      break;
+    }
+    rows = trace_reader_chunk_rows(r, i);
+    for (k = 0; k < rows; k++) {
+      for (c = 0; c < TRACE_COLUMNS; c++) row[c] = cols[c][k];
+      trace_csv_row(out, trace_reader_columns(r), row);
+    }
+  }
+  eprintf("%" PRIu64 " rows in %zu chunks\n", trace_reader_rows(r), trace_reader_chunks(r));
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    free(cols[c]);
+  }
+  if (out != stdout) fclose(out);
+  trace_reader_close(r);
+  return rv;
+}
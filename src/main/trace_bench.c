@@ -0,0 +1,145 @@
+//   _____                     _                     _
+//  |_   _| __ __ _  ___ ___  | |__   ___ _ __   ___| |__
+//    | || '__/ _` |/ __/ _ \ | '_ \ / _ \ '_ \ / __| '_ \
+//    | || | | (_| | (_|  __/ | |_) |  __/ | | | (__| | | |
+//    |_||_|  \__,_|\___\___| |_.__/ \___|_| |_|\___|_| |_|
+// Trace format benchmark: writes the same synthetic trajectory (a helix at
+// tq = 5 ms, blocks of 1 s) as CSV and as binary trace, then reads both
+// back, and reports file size and throughput.
+// Usage: trace_bench [rows] [directory]
+#include "../defines.h"
+#include "../trace.h"
+#include <sys/stat.h>
+
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+//
+// preprocessor macros and constants
+#define ROWS 1000000
+#define TQ 0.005
+#define BLOCK_ROWS 200
+#define BUFLEN 1024
+
+static void sample(size_t i, data_t *row) {
+  data_t t = i * TQ, t_blk = (i % BLOCK_ROWS) * TQ;
+  data_t lambda = t_blk / (BLOCK_ROWS * TQ);
+  row[0] = i / BLOCK_ROWS + 1;
+  row[1] = t;
+  row[2] = t_blk;
+  row[3] = lambda * lambda * (3 - 2 * lambda);
+  row[4] = row[3] * 25.0;
+  row[5] = 1000.0 * 6 * lambda * (1 - lambda);
+  row[6] = 50.0 * cos(t / 2);
+  row[7] = 50.0 * sin(t / 2);
+  row[8] = 0.1 * t;
+}
+
+static long file_size(const char *path) {
+  struct stat st;
+  return stat(path, &st) ? -1 : st.st_size;
+}
+
+static void print_row(const char *name, long size, size_t rows, data_t w, data_t r) {
+  printf("%-6s %10.2f %8.1f %12.0f %12.0f\n", name, size / 1E6,
+    (data_t)size / rows, rows / w, rows / r);
+}
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  size_t i, k, c, n = ROWS, chunk;
+  const char *dir = "/tmp";
+  char csv_path[BUFLEN], trc_path[BUFLEN], line[BUFLEN], *p;
+  data_t row[TRACE_COLUMNS], *cols[TRACE_COLUMNS], sum = 0;
+  data_t csv_w, csv_r, trc_w, trc_r;
+  uint64_t t0;
+  FILE *f;
+  trace_t *t;
+  trace_reader_t *r;
+
+  if (argc > 1) n = atol(argv[1]);
+  if (argc > 2) dir = argv[2];
+  if (n == 0) {
+    eprintf("Usage: %s [rows] [directory]\n", argv[0]);
+    return 1;
+  }
+  snprintf(csv_path, BUFLEN, "%s/trace_bench.csv", dir);
+  snprintf(trc_path, BUFLEN, "%s/trace_bench.trc", dir);
+  eprintf("%zu rows, files in %s\n", n, dir);
+
+  // CSV, formatted as by the logger
+  t0 = now_ns();
+  if (!(f = fopen(csv_path, "w"))) {
+    perror("Could not create CSV file");
+    return 2;
+  }
+  trace_csv_header(f, TRACE_ALL_COLUMNS);
+  for (i = 0; i < n; i++) {
+    sample(i, row);
+    trace_csv_row(f, TRACE_ALL_COLUMNS, row);
+  }
+  fclose(f);
+  csv_w = (now_ns() - t0) / 1E9;
+
+  t0 = now_ns();
+  if (!(f = fopen(csv_path, "r"))) {
+    perror("Could not open CSV file");
+    return 2;
+  }
+  fgets(line, BUFLEN, f);
+  while (fgets(line, BUFLEN, f)) {
+    for (p = line, c = 0; c < TRACE_COLUMNS; c++, p++) {
+      sum += strtod(p, &p);
+    }
+  }
+  fclose(f);
+  csv_r = (now_ns() - t0) / 1E9;
+
+  // binary trace
+  t0 = now_ns();
+  if (!(t = trace_open(trc_path, 0, TRACE_ALL_COLUMNS))) return 2;
+  for (i = 0; i < n; i++) {
+    sample(i, row);
+    trace_append(t, row);
+  }
+  trace_close(t);
+  trc_w = (now_ns() - t0) / 1E9;
+
+  t0 = now_ns();
+  if (!(r = trace_reader_open(trc_path))) return 2;
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    cols[c] = (data_t *)malloc(TRACE_CHUNK_ROWS * sizeof(data_t));
+  }
+  for (i = 0; i < trace_reader_chunks(r); i++) {
+    chunk = trace_reader_chunk_rows(r, i);
+    if (chunk > TRACE_CHUNK_ROWS || trace_reader_chunk(r, i, cols)) {
+      eprintf("Could not read chunk %zu\n", i);
+      return 3;
+    }
+    for (c = 0; c < TRACE_COLUMNS; c++) {
+      for (k = 0; k < chunk; k++) sum -= cols[c][k];
+    }
+  }
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    free(cols[c]);
+  }
+  trace_reader_close(r);
+  trc_r = (now_ns() - t0) / 1E9;
+
+  printf("format    size_MB  B/row  write_rows/s  read_rows/s\n");
+  print_row("csv", file_size(csv_path), n, csv_w, csv_r);
+  print_row("trace", file_size(trc_path), n, trc_w, trc_r);
+  // both readers must see the same numbers (to the CSV resolution)
+  eprintf("Checksum difference: %g\n", sum);
+  remove(csv_path);
+  remove(trc_path);
+  return 0;
+}
@@ -0,0 +1,102 @@
+//   ____                  _
+//  | __ )  ___ _ __   ___| |__
+//  |  _ \ / _ \ '_ \ / __| '_ \
+//  | |_) |  __/ | | | (__| | | |
+//  |____/ \___|_| |_|\___|_| |_|
+// Transport latency benchmark: measures the round trip time from
+// machine_sync() to the matching position coming back, over the selected
+// backend. Run machine_echo with the same transport in another terminal.
+// Usage: transport_bench [mqtt|shm|dgram] [samples]
+#include "../defines.h"
+#include "../machine.h"
+#include "../point.h"
+
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+//
+// preprocessor macros and constants
+#define INI_FILE "settings.ini"
+#define TIMEOUT 1000000000 // ns
+#define PERIOD 1000000     // ns between samples
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+//                   _
+//   _ __ ___   __ _(_)_ __
+//  | '_ ` _ \ / _` | | '_ \
+//  | | | | | | (_| | | | | |
+//  |_| |_| |_|\__,_|_|_| |_|
+//
+int main(int argc, char const *argv[]) {
+  machine_t *m = machine_new(INI_FILE);
+  machine_status_t st;
+  size_t i, n = 10000, got = 0, lost = 0;
+  uint64_t t0, *rtt;
+  data_t x, x0;
+  point_t *sp;
+
+  if (!m) {
+    eprintf("Error creating machine instance\n");
+    return 1;
+  }
+  if (argc > 1 && machine_select_transport(m, argv[1])) {
+    eprintf("Unknown transport %s\n", argv[1]);
+    return 1;
+  }
+  if (argc > 2) n = atol(argv[2]);
+  rtt = (uint64_t *)calloc(n, sizeof(uint64_t));
+  if (!rtt) {
+    perror("Could not allocate samples");
+    return 1;
+  }
+  if (machine_connect(m, NULL)) {
+    return 2;
+  }
+  machine_listen_start(m);
+  sp = machine_setpoint(m);
+  x0 = point_x(machine_zero(m)) + point_x(machine_offset(m));
+
+  eprintf("Measuring %zu round trips over %s\n", n, machine_transport(m));
+  for (i = 0; i < n; i++) {
+    // every sample has a distinct x, so that late replies are not mistaken
+    x = (i % 1000) * 0.001;
+    point_set_x(sp, point_x(machine_zero(m)) + x);
+    t0 = now_ns();
+    machine_sync(m, 0);
+    do {
+      machine_listen_update(m);
+      machine_status(m, &st);
+      if (fabs(st.x - x0 - x) < 1e-7) break;
+    } while (now_ns() - t0 < TIMEOUT);
+    if (now_ns() - t0 >= TIMEOUT) {
+      lost++;
+      continue;
+    }
+    rtt[got++] = st.t_recv - t0;
+    wait_next(PERIOD);
+  }
+
+  qsort(rtt, got, sizeof(uint64_t), cmp_u64);
+  printf("transport,samples,lost,min_us,p50_us,p99_us,p999_us,max_us\n");
+  if (got > 0) {
+    printf("%s,%zu,%zu,%.1f,%.1f,%.1f,%.1f,%.1f\n", machine_transport(m),
+      got, lost, rtt[0] / 1e3, rtt[got / 2] / 1e3, rtt[got * 99 / 100] / 1e3,
+      rtt[got * 999 / 1000] / 1e3, rtt[got - 1] / 1e3);
+  }
+  else {
+    printf("%s,0,%zu,,,,,\n", machine_transport(m), lost);
+  }
+
+  machine_listen_stop(m);
+  machine_disconnect(m);
+  machine_free(m);
+  free(rtt);
+  return 0;
+}
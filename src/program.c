@@ -21,6 +21,7 @@ typedef struct program {
   FILE *file;                      // file handle
   block_t *first, *last, *current; // block pointers
   size_t n;                        // total number of blocks
+  size_t index;                    // position of current in the list
 } program_t;
 
 
@@ -80,6 +81,23 @@ void program_print(const program_t *p, FILE *output) {
   } while (b);
 }
 
+void program_summary(const program_t *p, FILE *output) {
+  assert(p);
+  size_t n[NO_MOTION + 1] = {0};
+  data_t length = 0, dt = 0;
+  block_t *b;
+  for (b = p->first; b; b = block_next(b)) {
+    n[block_type(b)]++;
+    if (block_type(b) == LINE || block_type(b) == ARC_CW || block_type(b) == ARC_CCW) {
+      length += block_length(b);
+      dt += block_dt(b);
+    }
+  }
+  fprintf(output, "%s: %zu blocks (%zu rapids, %zu lines, %zu arcs), "
+    "%.1f mm in %.1f s of feed moves\n", p->filename, p->n, n[RAPID],
+    n[LINE], n[ARC_CW] + n[ARC_CCW], length, dt);
+}
+
 
 // PROCESSING ==================================================================
 
@@ -90,7 +108,6 @@ int program_parse(program_t *p, machine_t *cfg) {
   char *line = NULL;
   ssize_t line_len = 0;
   size_t n = 0;
-  block_t *b;
 
   // open the file
   p->file = fopen(p->filename, "r");
@@ -107,17 +124,9 @@ int program_parse(program_t *p, machine_t *cfg) {
     if (line[line_len-1] == '\n') {
       line[line_len-1] = '\0'; 
     }
-    if(!(b = block_new(line, p->last, cfg))) {
-      fprintf(stderr, "ERROR: creating the block %s\n", line);
+    if (program_append(p, line, cfg) == EXIT_FAILURE) {
       return EXIT_FAILURE;
     }
-    if (block_parse(b)) {
-      fprintf(stderr, "ERROR: parsing the block %s\n", line);
-      return EXIT_FAILURE;
-    }
-    if (p->first == NULL) p->first = b;
-    p->last = b;
-    p->n++;
   }
   fclose(p->file);
   free(line);
@@ -125,17 +134,55 @@ int program_parse(program_t *p, machine_t *cfg) {
   return EXIT_SUCCESS;
 }
 
+// add a block at the end of the program
+int program_append(program_t *p, const char *line, machine_t *cfg) {
+  assert(p && line && cfg);
+  block_t *b;
+  if(!(b = block_new(line, p->last, cfg))) {
+    fprintf(stderr, "ERROR: creating the block %s\n", line);
+    return EXIT_FAILURE;
+  }
+  if (block_parse(b)) {
+    fprintf(stderr, "ERROR: parsing the block %s\n", line);
+    return EXIT_FAILURE;
+  }
+  if (p->first == NULL) p->first = b;
+  p->last = b;
+  p->n++;
+  return EXIT_SUCCESS;
+}
+
 // linked-list navigation functions
 block_t *program_next(program_t *p) {
   assert(p);
-  if (p->current == NULL) p->current = p->first;
-  else p->current = block_next(p->current);
+  if (p->current == NULL) {
+    p->current = p->first;
+    p->index = 0;
+  }
+  else {
+    p->current = block_next(p->current);
+    p->index++;
+  }
   return p->current;
 }
 
 void program_reset(program_t *p) {
   assert(p);
   p->current = NULL;
+  p->index = 0;
+}
+
+block_t *program_seek(program_t *p, size_t index) {
+  assert(p);
+  block_t *b = p->first;
+  size_t i;
+  program_reset(p);
+  for (i = 0; i < index && b; i++) {
+    p->current = b;
+    p->index = i;
+    b = block_next(b);
+  }
+  return b;
 }
 
 
@@ -149,4 +196,5 @@ program_getter(char *, filename, filename);
 program_getter(block_t *, first, first);
 program_getter(block_t *, current, current);
 program_getter(block_t *, last, last);
-program_getter(size_t, n, length);
\ No newline at end of file
+program_getter(size_t, n, length);
+program_getter(size_t, index, index);
\ No newline at end of file
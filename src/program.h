@@ -41,21 +41,34 @@ void program_free(program_t *program);
 // print a program description
 void program_print(const program_t *program, FILE *output);
 
+// print a one line summary: blocks by type, feed length and time
+void program_summary(const program_t *program, FILE *output);
+
 // PROCESSING ==================================================================
 
 // parse the program
 // return either EXIT_SUCCESS or EXIT_FAILURE
 int program_parse(program_t *program, machine_t *cfg);
 
+// add a block at the end of the program (e.g. to build one in memory)
+// return either EXIT_SUCCESS or EXIT_FAILURE
+int program_append(program_t *program, const char *line, machine_t *cfg);
+
 // linked-list navigation functions
 block_t *program_next(program_t *program);
 void program_reset(program_t *program);
 
+// move so that the next program_next() returns the block at index (0 is
+// the first one); returns that block, or NULL if past the end
+block_t *program_seek(program_t *program, size_t index);
+
 
 // GETTERS =====================================================================
 
 char *program_filename(const program_t *p);
 size_t program_length(const program_t *p);
+// position of the current block (0 is the first one)
+size_t program_index(const program_t *p);
 block_t *program_current(const program_t *p);
 block_t *program_first(const program_t *p);
 block_t *program_last(const program_t *p);
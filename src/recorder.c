@@ -0,0 +1,230 @@
+//   ____                        _
+//  |  _ \ ___  ___ ___  _ __ __| | ___ _ __
+//  | |_) / _ \/ __/ _ \| '__/ _` |/ _ \ '__|
+//  |  _ <  __/ (_| (_) | | | (_| |  __/ |
+//  |_| \_\___|\___\___/|_|  \__,_|\___|_|
+//
+
+#include "recorder.h"
+#include "inic.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define BUFLEN 1024
+#define MAGIC "CCNCREC1"
+// live recorders, for the crash handler
+#define MAX_RECORDERS 64
+
+const char *rec_reason_names[] = {"stop", "signal", "fault", "crash"};
+
+// Recorder object structure
+typedef struct recorder {
+  int enabled;
+  char path[2 * BUFLEN];     // dump file
+  data_t tq;
+  rec_entry_t *ring;
+  size_t mask;               // capacity - 1
+  uint64_t total;            // records added so far
+  uint64_t start;            // creation time (ns)
+} recorder_t;
+
+static recorder_t *_recorders[MAX_RECORDERS];
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int write_all(int fd, const void *buf, size_t len);
+static void crash_handler(int signal);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+recorder_t *recorder_new(const char *ini_path, data_t tq, const char *id) {
+  assert(ini_path && tq > 0);
+  void *ini;
+  char file[BUFLEN], *ext;
+  data_t seconds;
+  size_t i, len = 1;
+  recorder_t *r = (recorder_t *)calloc(1, sizeof(recorder_t));
+  if (!r) {
+    perror("Could not allocate recorder");
+    return NULL;
+  }
+  ini = ini_init(ini_path);
+  if (!ini) {
+    eprintf("Could not open the ini file %s\n", ini_path);
+    free(r);
+    return NULL;
+  }
+  // all optional
+  if (ini_get_int(ini, "RECORDER", "enabled", &r->enabled))
+    r->enabled = 1;
+  if (ini_get_double(ini, "RECORDER", "seconds", &seconds))
+    seconds = 10;
+  if (ini_get_char(ini, "RECORDER", "file", file, BUFLEN))
+    strcpy(file, "c-cnc.rec");
+  ini_free(ini);
+  r->tq = tq;
+  r->start = now_ns();
+  if (!r->enabled) return r;
+  // c-cnc.rec -> c-cnc-<id>.rec
+  if (id) {
+    ext = strrchr(file, '.');
+    if (ext && !strchr(ext, '/')) {
+      snprintf(r->path, sizeof(r->path), "%.*s-%s%s", (int)(ext - file), file, id, ext);
+    }
+    else {
+      snprintf(r->path, sizeof(r->path), "%s-%s", file, id);
+    }
+  }
+  else {
+    strncpy(r->path, file, sizeof(r->path) - 1);
+  }
+  while (len < MAX(1, seconds / tq)) len <<= 1;
+  // calloc, then touched: the pages are mapped before the loop starts
+  r->ring = (rec_entry_t *)calloc(len, sizeof(rec_entry_t));
+  if (!r->ring) {
+    perror("Could not allocate recorder ring");
+    free(r);
+    return NULL;
+  }
+  memset(r->ring, 0, len * sizeof(rec_entry_t));
+  r->mask = len - 1;
+  for (i = 0; i < MAX_RECORDERS; i++) {
+    if (!_recorders[i]) {
+      _recorders[i] = r;
+      break;
+    }
+  }
+  return r;
+}
+
+void recorder_free(recorder_t *r) {
+  assert(r);
+  size_t i;
+  for (i = 0; i < MAX_RECORDERS; i++) {
+    if (_recorders[i] == r) _recorders[i] = NULL;
+  }
+  free(r->ring);
+  free(r);
+  r = NULL;
+}
+
+
+// RECORDING ===================================================================
+
+void recorder_add(recorder_t *r, const rec_entry_t *e) {
+  assert(r && e);
+  if (!r->ring) return;
+  r->ring[r->total & r->mask] = *e;
+  r->total++;
+}
+
+uint64_t recorder_time(const recorder_t *r, uint64_t now) {
+  assert(r);
+  return now - r->start;
+}
+
+
+// DUMPING =====================================================================
+
+int recorder_dump(recorder_t *r, rec_reason_t reason, int signal) {
+  assert(r);
+  rec_header_t h = {
+    .magic = MAGIC,
+    .record_size = sizeof(rec_entry_t),
+    .reason = reason,
+    .signal = signal,
+    .total = r->total,
+    .tq = r->tq
+  };
+  size_t capacity = r->mask + 1, first;
+  int fd, rv = 0;
+  if (!r->ring) return 0;
+  h.records = MIN(r->total, capacity);
+  // oldest record: the next one to be overwritten, once the ring wrapped
+  first = r->total > capacity ? (r->total & r->mask) : 0;
+  fd = open(r->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return 1;
+  rv += write_all(fd, &h, sizeof(h));
+  rv += write_all(fd, r->ring + first, (h.records - first) * sizeof(rec_entry_t));
+  if (first > 0) {
+    rv += write_all(fd, r->ring, first * sizeof(rec_entry_t));
+  }
+  rv += close(fd) ? 1 : 0;
+  return rv;
+}
+
+void recorder_catch_crashes(void) {
+  struct sigaction sa = {.sa_handler = crash_handler, .sa_flags = SA_RESETHAND};
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGSEGV, &sa, NULL);
+  sigaction(SIGBUS, &sa, NULL);
+  sigaction(SIGFPE, &sa, NULL);
+  sigaction(SIGILL, &sa, NULL);
+  sigaction(SIGABRT, &sa, NULL);
+}
+
+
+// GETTERS =====================================================================
+
+int recorder_enabled(const recorder_t *r) {
+  assert(r);
+  return r->enabled;
+}
+
+const char *recorder_path(const recorder_t *r) {
+  assert(r);
+  return r->path;
+}
+
+uint64_t recorder_total(const recorder_t *r) {
+  assert(r);
+  return r->total;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__\___|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+static int write_all(int fd, const void *buf, size_t len) {
+  const char *p = (const char *)buf;
+  ssize_t n;
+  while (len > 0) {
+    n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return 1;
+    }
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// async-signal-safe: open(), write() and close() only. The step being
+// recorded when the signal hit, if any, may be torn
+static void crash_handler(int signal) {
+  size_t i;
+  for (i = 0; i < MAX_RECORDERS; i++) {
+    if (_recorders[i]) recorder_dump(_recorders[i], REC_CRASH, signal);
+  }
+  // SA_RESETHAND restored the default action
+  raise(signal);
+}
@@ -0,0 +1,108 @@
+//   ____                        _
+//  |  _ \ ___  ___ ___  _ __ __| | ___ _ __
+//  | |_) / _ \/ __/ _ \| '__/ _` |/ _ \ '__|
+//  |  _ <  __/ (_| (_) | | | (_| |  __/ |
+//  |_| \_\___|\___\___/|_|  \__,_|\___|_|
+//  Flight recorder class
+//  Always-on black box: every FSM step stores a fixed-size record (time,
+//  step duration, states, block, setpoint, actual position, error) in a
+//  preallocated ring that only keeps the last few seconds. Nothing is
+//  written out until the ring is dumped: on stop, on a fault, on SIGINT
+//  or, through recorder_catch_crashes(), on a fatal signal.
+//
+//  Dump file layout (native endianness, see rec2csv):
+//    header   "CCNCREC1", u32 record size, u32 reason, u32 signal, u32 0,
+//             u64 records in the file, u64 records since start, f64 tq
+//    records  rec_entry_t, oldest first
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct recorder recorder_t;
+
+// One FSM step
+typedef struct {
+  uint64_t time;        // step start (ns, since recorder_new())
+  uint32_t duration;    // step duration, transition included (ns)
+  uint16_t state;       // state executed
+  uint16_t next;        // state after the step
+  uint64_t block;       // block number (0 if none)
+  data_t t_tot;         // program time
+  data_t sp_x, sp_y, sp_z;    // setpoint
+  data_t x, y, z;       // actual position (feedback)
+  data_t error;         // positioning error
+} rec_entry_t;
+
+// Why the ring was dumped
+typedef enum {
+  REC_STOP = 0,         // normal stop
+  REC_SIGNAL,           // stop requested with SIGINT
+  REC_FAULT,            // stop after an error
+  REC_CRASH             // fatal signal
+} rec_reason_t;
+
+typedef struct {
+  char magic[8];        // "CCNCREC1"
+  uint32_t record_size; // sizeof(rec_entry_t)
+  uint32_t reason;      // rec_reason_t
+  uint32_t signal;      // for REC_CRASH
+  uint32_t pad;
+  uint64_t records;     // in the file
+  uint64_t total;       // recorded since start
+  data_t tq;
+} rec_header_t;
+
+extern const char *rec_reason_names[];
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Read the [RECORDER] section of the INI file and allocate a ring holding
+// the given seconds of steps of tq each. If id is not NULL, it is appended
+// to the dump file name (many machines in one process). Returns NULL on
+// failure
+recorder_t *recorder_new(const char *ini_path, data_t tq, const char *id);
+void recorder_free(recorder_t *r);
+
+// RECORDING ===================================================================
+
+// Store a step, overwriting the oldest one when the ring is full. No
+// system calls, no allocations
+void recorder_add(recorder_t *r, const rec_entry_t *e);
+
+// Time stamp for rec_entry_t.time
+uint64_t recorder_time(const recorder_t *r, uint64_t now);
+
+// DUMPING =====================================================================
+
+// Write the ring to the dump file, using only async-signal-safe calls.
+// Returns 0 on success
+int recorder_dump(recorder_t *r, rec_reason_t reason, int signal);
+
+// Dump every live recorder on SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT,
+// then let the signal take its default action
+void recorder_catch_crashes(void);
+
+// GETTERS =====================================================================
+
+int recorder_enabled(const recorder_t *r);
+const char *recorder_path(const recorder_t *r);
+uint64_t recorder_total(const recorder_t *r);
+
+#endif // RECORDER_H
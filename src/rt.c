@@ -0,0 +1,260 @@
+//   ____            _ _   _
+//  |  _ \ ___  __ _| | |_(_)_ __ ___   ___
+//  | |_) / _ \/ _` | | __| | '_ ` _ \ / _ \
+//  |  _ <  __/ (_| | | |_| | | | | | |  __/
+//  |_| \_\___|\__,_|_|\__|_|_| |_| |_|\___|
+//
+
+#include "rt.h"
+#include "inic.h"
+#include <errno.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <alloca.h>
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// the default stack limit is 8 MB: stay well below it
+#define MAX_STACK_KB 4096
+
+// Realtime setup object structure
+typedef struct rt {
+  int enabled;
+  int priority;              // SCHED_FIFO priority, 0 to keep SCHED_OTHER
+  int cpu;                   // CPU to pin to, -1 for none
+  int lock_memory;           // mlockall()
+  int prefault_stack;        // kB
+  int prefault_heap;         // kB
+  struct rusage start;       // usage at rt_enter()
+} rt_t;
+
+#ifdef __linux__
+// CPU mask before rt_enter() pinned the thread, for rt_thread_create()
+static cpu_set_t _default_cpus;
+static int _default_cpus_saved = 0;
+#endif
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static void prefault_stack(size_t size);
+static int prefault_heap(size_t size);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+rt_t *rt_new(const char *ini_path) {
+  assert(ini_path);
+  void *ini;
+  rt_t *rt = (rt_t *)calloc(1, sizeof(rt_t));
+  if (!rt) {
+    perror("Could not allocate realtime setup");
+    return NULL;
+  }
+  ini = ini_init(ini_path);
+  if (!ini) {
+    eprintf("Could not open the ini file %s\n", ini_path);
+    free(rt);
+    return NULL;
+  }
+  // all optional
+  ini_get_int(ini, "RT", "enabled", &rt->enabled);
+  if (ini_get_int(ini, "RT", "priority", &rt->priority))
+    rt->priority = 80;
+  if (ini_get_int(ini, "RT", "cpu", &rt->cpu))
+    rt->cpu = -1;
+  if (ini_get_int(ini, "RT", "lock_memory", &rt->lock_memory))
+    rt->lock_memory = 1;
+  if (ini_get_int(ini, "RT", "prefault_stack", &rt->prefault_stack))
+    rt->prefault_stack = 256;
+  if (ini_get_int(ini, "RT", "prefault_heap", &rt->prefault_heap))
+    rt->prefault_heap = 4096;
+  ini_free(ini);
+  rt->prefault_stack = MAX(0, MIN(rt->prefault_stack, MAX_STACK_KB));
+  rt->prefault_heap = MAX(0, rt->prefault_heap);
+  return rt;
+}
+
+void rt_free(rt_t *rt) {
+  assert(rt);
+  free(rt);
+  rt = NULL;
+}
+
+
+// SETUP =======================================================================
+
+#ifdef __linux__
+int rt_enter(rt_t *rt) {
+  assert(rt);
+  int rc, failed = 0;
+  struct sched_param param = {.sched_priority = rt->priority};
+  cpu_set_t cpus;
+
+  if (!rt->enabled) return 0;
+  // 1. CPU pinning
+  if (rt->cpu >= 0) {
+    if (!_default_cpus_saved &&
+        !pthread_getaffinity_np(pthread_self(), sizeof(_default_cpus), &_default_cpus)) {
+      _default_cpus_saved = 1;
+    }
+    CPU_ZERO(&cpus);
+    CPU_SET(rt->cpu, &cpus);
+    if ((rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))) {
+      eprintf("-X Realtime: cannot pin to CPU %d: %s\n", rt->cpu, strerror(rc));
+      failed++;
+    }
+    else {
+      eprintf("-> Realtime: pinned to CPU %d\n", rt->cpu);
+    }
+  }
+  // 2. pre-faulting: the pages the loop will touch are mapped now, rather
+  //    than at the first tick that needs them
+  if (rt->prefault_stack > 0) {
+    prefault_stack((size_t)rt->prefault_stack * 1024);
+  }
+  if (rt->prefault_heap > 0) {
+    if (prefault_heap((size_t)rt->prefault_heap * 1024)) {
+      failed++;
+    }
+  }
+  // 3. memory locking: no page is ever swapped out. After pre-faulting, so
+  //    that a low memlock limit makes this step fail rather than any later
+  //    allocation
+  if (rt->lock_memory) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+      rc = errno;
+      eprintf("-X Realtime: cannot lock memory: %s%s\n", strerror(rc),
+        (rc == ENOMEM || rc == EPERM) ?
+        " (raise the memlock limit, ulimit -l, or grant CAP_IPC_LOCK)" : "");
+      failed++;
+    }
+    else {
+      eprintf("-> Realtime: memory locked\n");
+    }
+  }
+  // 4. scheduling, last: the steps above may take a while
+  if (rt->priority > 0) {
+    if ((rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))) {
+      eprintf("-X Realtime: cannot set SCHED_FIFO priority %d: %s%s\n",
+        rt->priority, strerror(rc), rc == EPERM ?
+        " (grant CAP_SYS_NICE or raise the rtprio limit, ulimit -r)" : "");
+      failed++;
+    }
+    else {
+      eprintf("-> Realtime: SCHED_FIFO priority %d\n", rt->priority);
+    }
+  }
+  if (failed) {
+    eprintf("-X Realtime: %d step(s) failed, running with reduced guarantees\n", failed);
+  }
+  getrusage(RUSAGE_SELF, &rt->start);
+  return failed;
+}
+#else
+int rt_enter(rt_t *rt) {
+  assert(rt);
+  if (!rt->enabled) return 0;
+  eprintf("-X Realtime: not supported on this platform, running as a normal process\n");
+  getrusage(RUSAGE_SELF, &rt->start);
+  return 1;
+}
+#endif
+
+#ifdef __linux__
+int rt_thread_create(pthread_t *tid, void *(*run)(void *), void *arg) {
+  assert(tid && run);
+  int rc;
+  pthread_attr_t attr;
+  struct sched_param param = {.sched_priority = 0};
+  if ((rc = pthread_attr_init(&attr))) return rc;
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if (_default_cpus_saved) {
+    pthread_attr_setaffinity_np(&attr, sizeof(_default_cpus), &_default_cpus);
+  }
+  rc = pthread_create(tid, &attr, run, arg);
+  pthread_attr_destroy(&attr);
+  return rc;
+}
+#else
+int rt_thread_create(pthread_t *tid, void *(*run)(void *), void *arg) {
+  assert(tid && run);
+  return pthread_create(tid, NULL, run, arg);
+}
+#endif
+
+void rt_report(const rt_t *rt, FILE *out) {
+  assert(rt && out);
+  struct rusage now;
+  if (!rt->enabled) return;
+  getrusage(RUSAGE_SELF, &now);
+  fprintf(out, "Realtime: %ld minor and %ld major page faults, %ld involuntary context switches\n",
+    now.ru_minflt - rt->start.ru_minflt, now.ru_majflt - rt->start.ru_majflt,
+    now.ru_nivcsw - rt->start.ru_nivcsw);
+}
+
+
+// GETTERS =====================================================================
+
+int rt_enabled(const rt_t *rt) {
+  assert(rt);
+  return rt->enabled;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Touch size bytes of stack below the current frame; never inlined, so
+// that the pages stay mapped for the deeper calls of the realtime loop
+static __attribute__((noinline)) void prefault_stack(size_t size) {
+  volatile unsigned char *buf = alloca(size);
+  size_t i;
+  for (i = 0; i < size; i += 512) {
+    buf[i] = 0;
+  }
+}
+
+// Map size bytes of heap and give them back to malloc, which keeps them:
+// later allocations (e.g. stdio buffers, printf internals) do not fault
+static int prefault_heap(size_t size) {
+  unsigned char *buf;
+  size_t i;
+#ifdef __GLIBC__
+  // never return memory to the OS, never use mmap for big blocks
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+#endif
+  buf = (unsigned char *)malloc(size);
+  if (!buf) {
+    eprintf("-X Realtime: cannot pre-fault %zu kB of heap\n", size / 1024);
+    return 1;
+  }
+  for (i = 0; i < size; i += 512) {
+    buf[i] = 0;
+  }
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,65 @@
+//   ____            _ _   _
+//  |  _ \ ___  __ _| | |_(_)_ __ ___   ___
+//  | |_) / _ \/ _` | | __| | '_ ` _ \ / _ \
+//  |  _ <  __/ (_| | | |_| | | | | | |  __/
+//  |_| \_\___|\__,_|_|\__|_|_| |_| |_|\___|
+//
+//  Realtime setup class
+//  Opt-in realtime execution of the calling thread, configured in the [RT]
+//  section of the INI file: CPU pinning, locked and pre-faulted memory,
+//  SCHED_FIFO priority. Each step that fails (typically for missing
+//  privileges) is reported with the reason and skipped, so that the
+//  controller still runs as a normal process. Linux only.
+
+#ifndef RT_H
+#define RT_H
+
+#include "defines.h"
+#include <pthread.h>
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct rt rt_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Read the [RT] section; a missing section means realtime mode disabled.
+// Returns NULL on failure
+rt_t *rt_new(const char *ini_path);
+void rt_free(rt_t *rt);
+
+// SETUP =======================================================================
+
+// Apply the configuration to the calling thread. Call it once everything
+// used by the realtime loop has been allocated, right before the loop.
+// Returns the number of steps that could not be applied (0: all done)
+int rt_enter(rt_t *rt);
+
+// Print page faults and involuntary context switches since rt_enter()
+void rt_report(const rt_t *rt, FILE *out);
+
+// Threads inherit the scheduling and the CPU pinning of their creator: a
+// helper started after rt_enter() would compete with the realtime loop on
+// its CPU. Start helpers with this instead of pthread_create(): they get
+// SCHED_OTHER and the CPU mask the process had before rt_enter().
+// Returns 0 or an error number, like pthread_create()
+int rt_thread_create(pthread_t *tid, void *(*run)(void *), void *arg);
+
+// GETTERS =====================================================================
+
+int rt_enabled(const rt_t *rt);
+
+#endif // RT_H
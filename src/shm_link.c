@@ -0,0 +1,208 @@
+//   ____  _                 _     _       _
+//  / ___|| |__  _ __ ___   | |   (_)_ __ | | __
+//  \___ \| '_ \| '_ ` _ \  | |   | | '_ \| |/ /
+//   ___) | | | | | | | | | | |___| | | | |   <
+//  |____/|_| |_|_| |_| |_| |_____|_|_| |_|_|\_\
+
+#include "shm_link.h"
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// Must be a power of 2
+#define RING_LEN 1024
+#define CACHE_LINE 64
+
+// Single-producer/single-consumer ring. head and tail grow indefinitely
+// and are masked on access; an all-zero ring is a valid empty ring, so a
+// freshly created shared memory object needs no initialization.
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_uint_fast64_t head; // written by producer
+  _Alignas(CACHE_LINE) atomic_uint_fast64_t tail; // written by consumer
+  _Alignas(CACHE_LINE) atomic_uint futex;         // bumped at every push
+  atomic_uint waiting;                            // consumer is sleeping
+  _Alignas(CACHE_LINE) shm_msg_t buf[RING_LEN];
+} ring_t;
+
+// Layout of the shared memory object
+typedef struct {
+  ring_t setpoint; // controller -> machine
+  ring_t status;   // machine -> controller
+} shm_area_t;
+
+// Link object structure
+typedef struct shm_link {
+  char *name;          // shared memory object name
+  shm_area_t *area;    // mapped area
+  ring_t *tx, *rx;     // outgoing and incoming rings
+} shm_link_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int ring_push(ring_t *r, const shm_msg_t *msg);
+static int ring_pop(ring_t *r, shm_msg_t *msg);
+static void futex_wait(atomic_uint *addr, unsigned int val, uint64_t timeout_ns);
+static void futex_wake(atomic_uint *addr);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+shm_link_t *shm_link_open(const char *name, shm_side_t side) {
+  assert(name);
+  int fd;
+  struct stat st;
+  shm_link_t *l = (shm_link_t *)calloc(1, sizeof(shm_link_t));
+  if (!l) {
+    perror("Could not allocate shm link");
+    return NULL;
+  }
+  // whoever comes first creates the object; the size is only set once, so
+  // that the other side never sees the area being truncated under its feet
+  fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) {
+    perror("Could not open shared memory");
+    free(l);
+    return NULL;
+  }
+  if (fstat(fd, &st) || (st.st_size != sizeof(shm_area_t) &&
+      ftruncate(fd, sizeof(shm_area_t)))) {
+    perror("Could not size shared memory");
+    close(fd);
+    free(l);
+    return NULL;
+  }
+  l->area = (shm_area_t *)mmap(NULL, sizeof(shm_area_t),
+    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (l->area == MAP_FAILED) {
+    perror("Could not map shared memory");
+    free(l);
+    return NULL;
+  }
+  l->name = strdup(name);
+  if (side == SHM_CONTROLLER) {
+    l->tx = &l->area->setpoint;
+    l->rx = &l->area->status;
+  }
+  else {
+    l->tx = &l->area->status;
+    l->rx = &l->area->setpoint;
+  }
+  return l;
+}
+
+void shm_link_close(shm_link_t *l) {
+  assert(l);
+  munmap(l->area, sizeof(shm_area_t));
+  free(l->name);
+  free(l);
+  l = NULL;
+}
+
+
+// COMMUNICATIONS ==============================================================
+
+int shm_link_send(shm_link_t *l, const shm_msg_t *msg) {
+  assert(l && msg);
+  if (ring_push(l->tx, msg)) return 1;
+  // only pay for the syscall if the other side is actually sleeping
+  atomic_fetch_add_explicit(&l->tx->futex, 1, memory_order_release);
+  if (atomic_load_explicit(&l->tx->waiting, memory_order_seq_cst))
+    futex_wake(&l->tx->futex);
+  return 0;
+}
+
+int shm_link_recv(shm_link_t *l, shm_msg_t *msg) {
+  assert(l && msg);
+  return ring_pop(l->rx, msg) ? 0 : 1;
+}
+
+int shm_link_wait(shm_link_t *l, shm_msg_t *msg, uint64_t timeout_ns) {
+  assert(l && msg);
+  uint64_t t0 = now_ns();
+  uint64_t elapsed;
+  unsigned int val;
+  while (1) {
+    val = atomic_load_explicit(&l->rx->futex, memory_order_acquire);
+    if (ring_pop(l->rx, msg) == 0) return 1;
+    elapsed = now_ns() - t0;
+    if (timeout_ns && elapsed >= timeout_ns) return 0;
+    atomic_store_explicit(&l->rx->waiting, 1, memory_order_seq_cst);
+    futex_wait(&l->rx->futex, val, timeout_ns ? timeout_ns - elapsed : 0);
+    atomic_store_explicit(&l->rx->waiting, 0, memory_order_relaxed);
+  }
+}
+
+void shm_link_drain(shm_link_t *l) {
+  assert(l);
+  uint_fast64_t head = atomic_load_explicit(&l->rx->head, memory_order_acquire);
+  atomic_store_explicit(&l->rx->tail, head, memory_order_release);
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Returns 0 on success, 1 if the ring is full
+static int ring_push(ring_t *r, const shm_msg_t *msg) {
+  uint_fast64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  uint_fast64_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+  if (head - tail >= RING_LEN) return 1;
+  r->buf[head & (RING_LEN - 1)] = *msg;
+  atomic_store_explicit(&r->head, head + 1, memory_order_release);
+  return 0;
+}
+
+// Returns 0 on success, 1 if the ring is empty
+static int ring_pop(ring_t *r, shm_msg_t *msg) {
+  uint_fast64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  uint_fast64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+  if (head == tail) return 1;
+  *msg = r->buf[tail & (RING_LEN - 1)];
+  atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+  return 0;
+}
+
+// Sleep until *addr differs from val, or timeout (0 means forever).
+// The futex is shared among processes, so the PRIVATE flag is not used
+static void futex_wait(atomic_uint *addr, unsigned int val, uint64_t timeout_ns) {
+#ifdef __linux__
+  struct timespec ts = {
+    .tv_sec = timeout_ns / 1000000000,
+    .tv_nsec = timeout_ns % 1000000000
+  };
+  syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAIT, val,
+    timeout_ns ? &ts : NULL, NULL, 0);
+#else
+  usleep(100);
+#endif
+}
+
+static void futex_wake(atomic_uint *addr) {
+#ifdef __linux__
+  syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
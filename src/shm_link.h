@@ -0,0 +1,78 @@
+//   ____  _                 _     _       _
+//  / ___|| |__  _ __ ___   | |   (_)_ __ | | __
+//  \___ \| '_ \| '_ ` _ \  | |   | | '_ \| |/ /
+//   ___) | | | | | | | | | | |___| | | | |   <
+//  |____/|_| |_|_| |_| |_| |_____|_|_| |_|_|\_\
+//  Shared-memory link class
+//  Two single-producer/single-consumer rings in a POSIX shared memory
+//  object: setpoints go from the controller to the machine, status comes
+//  back from the machine to the controller. Consumers may block on a futex
+//  until new data is available (Linux only, elsewhere they poll).
+
+#ifndef SHM_LINK_H
+#define SHM_LINK_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct shm_link shm_link_t;
+
+// Message exchanged in both directions. Setpoints use x, y, z and rapid;
+// status messages use x, y, z (actual position) and error, and echo seq
+// and t_sent of the last setpoint received.
+typedef struct {
+  uint64_t seq;         // setpoint sequence number
+  uint64_t t_sent;      // setpoint send time (ns, see now_ns())
+  data_t x, y, z;       // coordinates
+  data_t error;         // positioning error
+  int32_t rapid;        // rapid motion flag
+  int32_t pad;
+} shm_msg_t;
+
+// Link side: the controller pushes setpoints and pops status, the machine
+// does the opposite
+typedef enum {
+  SHM_CONTROLLER = 0,
+  SHM_MACHINE
+} shm_side_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Open (and create, if needed) the shared memory object with the given name
+// (e.g. "/c-cnc"). Returns NULL on failure
+shm_link_t *shm_link_open(const char *name, shm_side_t side);
+void shm_link_close(shm_link_t *l);
+
+// COMMUNICATIONS ==============================================================
+
+// Push a message on the outgoing ring. Never blocks. Returns 0 on success,
+// 1 if the ring is full (message dropped)
+int shm_link_send(shm_link_t *l, const shm_msg_t *msg);
+
+// Pop a message from the incoming ring. Never blocks. Returns 1 if a
+// message was read, 0 if the ring is empty
+int shm_link_recv(shm_link_t *l, shm_msg_t *msg);
+
+// Wait for a message on the incoming ring for at most timeout_ns
+// nanoseconds (0 means forever). Returns 1 if a message was read, 0 on
+// timeout
+int shm_link_wait(shm_link_t *l, shm_msg_t *msg, uint64_t timeout_ns);
+
+// Discard all pending incoming messages
+void shm_link_drain(shm_link_t *l);
+
+#endif // SHM_LINK_H
@@ -0,0 +1,99 @@
+//   _____ _      _
+//  |_   _(_) ___| | _____ _ __
+//    | | | |/ __| |/ / _ \ '__|
+//    | | | | (__|   <  __/ |
+//    |_| |_|\___|_|\_\___|_|
+//
+
+#include "ticker.h"
+#include "timeline.h"
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+// Ticker object structure
+typedef struct ticker {
+  uint64_t period, spin;     // ns
+  uint64_t deadline;         // next wakeup (ns, see now_ns())
+  uint64_t overruns;
+  histogram_t *lateness;
+} ticker_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+ticker_t *ticker_new(uint64_t period, uint64_t spin) {
+  ticker_t *t = (ticker_t *)calloc(1, sizeof(ticker_t));
+  if (!t) {
+    perror("Could not allocate ticker");
+    return NULL;
+  }
+  t->lateness = histogram_new();
+  if (!t->lateness) {
+    free(t);
+    return NULL;
+  }
+  t->period = period;
+  t->spin = spin;
+#ifdef __linux__
+  // sleeps of normal threads may otherwise be stretched by up to 50 us
+  // (the default timer slack), more than the spin usually covers
+  prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+  ticker_start(t);
+  return t;
+}
+
+void ticker_free(ticker_t *t) {
+  assert(t);
+  histogram_free(t->lateness);
+  free(t);
+  t = NULL;
+}
+
+void ticker_start(ticker_t *t) {
+  assert(t);
+  t->deadline = now_ns() + t->period;
+}
+
+
+// TIMING ======================================================================
+
+uint64_t ticker_wait(ticker_t *t) {
+  assert(t);
+  uint64_t t0 = timeline_enabled() ? now_ns() : 0;
+  uint64_t late = sleep_until(t->deadline, t->spin);
+  if (t0) timeline_span("tick", "sleep", t0, now_ns(), "late_ns", late);
+  histogram_add(t->lateness, late);
+  if (late > t->period) t->overruns++;
+  t->deadline += t->period;
+  return late;
+}
+
+void ticker_set_period(ticker_t *t, uint64_t period) {
+  assert(t);
+  t->period = period;
+}
+
+
+// GETTERS =====================================================================
+
+#define ticker_getter(typ, par) \
+typ ticker_##par(const ticker_t *t) { assert(t); return t->par; }
+
+ticker_getter(uint64_t, period);
+ticker_getter(uint64_t, spin);
+ticker_getter(uint64_t, overruns);
+ticker_getter(const histogram_t *, lateness);
@@ -0,0 +1,68 @@
+//   _____ _      _
+//  |_   _(_) ___| | _____ _ __
+//    | | | |/ __| |/ / _ \ '__|
+//    | | | | (__|   <  __/ |
+//    |_| |_|\___|_|\_\___|_|
+//
+//  Ticker class
+//  Periodic wakeups on an absolute schedule: the thread sleeps with
+//  clock_nanosleep() until spin ns before each deadline and busy-waits only
+//  for that final stretch (see sleep_until()), so an idle controller uses
+//  next to no CPU. The lateness of every wakeup goes into a histogram.
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include "defines.h"
+#include "histogram.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct ticker ticker_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   \__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// period and spin in ns; spin 0 means pure sleep, spin >= period pure
+// busy-wait. On Linux, also sets the timer slack of the calling thread to
+// the minimum. Returns NULL on failure
+ticker_t *ticker_new(uint64_t period, uint64_t spin);
+void ticker_free(ticker_t *t);
+
+// Restart the schedule: the next deadline is one period from now
+void ticker_start(ticker_t *t);
+
+// TIMING ======================================================================
+
+// Wait for the next deadline and return the lateness (ns). If a tick ran
+// longer than a period, the missed deadlines are not skipped (as with
+// wait_next()), but counted as overruns
+uint64_t ticker_wait(ticker_t *t);
+
+// Change the period; the current deadline is kept
+void ticker_set_period(ticker_t *t, uint64_t period);
+
+// GETTERS =====================================================================
+
+uint64_t ticker_period(const ticker_t *t);
+uint64_t ticker_spin(const ticker_t *t);
+
+// number of waits that returned more than one period late
+uint64_t ticker_overruns(const ticker_t *t);
+
+// wakeup lateness (ns)
+const histogram_t *ticker_lateness(const ticker_t *t);
+
+#endif // TICKER_H
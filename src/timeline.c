@@ -0,0 +1,190 @@
+//   _____ _                _ _
+//  |_   _(_)_ __ ___   ___| (_)_ __   ___
+//    | | | | '_ ` _ \ / _ \ | | '_ \ / _ \
+//    | | | | | | | | |  __/ | | | | |  __/
+//    |_| |_|_| |_| |_|\___|_|_|_| |_|\___|
+//
+
+#include "timeline.h"
+#include <stdatomic.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <inttypes.h>
+#endif
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+typedef struct {
+  uint64_t ts, dur;          // ns
+  const char *cat, *name, *key;
+  int64_t value;
+  uint32_t tid;
+  char ph;                   // Chrome trace phase: X span, i instant, M name
+} event_t;
+
+// the timeline is a singleton: events come from code (e.g. the network
+// callbacks) that has no handle to pass it around
+static struct {
+  event_t *events;
+  size_t capacity;
+  uint64_t start;            // ns
+  atomic_size_t next;        // next free slot
+  atomic_uint_fast64_t dropped;
+  atomic_int on;
+} _tl;
+
+static _Thread_local uint32_t _tid = 0;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static event_t *reserve(void);
+static uint32_t thread_id(void);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+int timeline_start(size_t capacity) {
+  assert(capacity > 0);
+  if (atomic_load(&_tl.on)) return 0;
+  _tl.events = (event_t *)calloc(capacity, sizeof(event_t));
+  if (!_tl.events) {
+    perror("Could not allocate timeline");
+    return 1;
+  }
+  // touch the pages now, not during the run
+  memset(_tl.events, 0, capacity * sizeof(event_t));
+  _tl.capacity = capacity;
+  _tl.start = now_ns();
+  atomic_store(&_tl.next, 0);
+  atomic_store(&_tl.dropped, 0);
+  atomic_store_explicit(&_tl.on, 1, memory_order_release);
+  return 0;
+}
+
+int timeline_write(const char *path) {
+  assert(path);
+  FILE *f;
+  size_t i, n;
+  event_t *e;
+  int rv = 0;
+  if (!atomic_load(&_tl.on)) return 1;
+  atomic_store_explicit(&_tl.on, 0, memory_order_release);
+  n = MIN(atomic_load(&_tl.next), _tl.capacity);
+  if (!(f = fopen(path, "w"))) {
+    perror("Could not create timeline file");
+    rv = 1;
+    goto free_events;
+  }
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf(f, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"c-cnc\"}}");
+  for (i = 0; i < n; i++) {
+    e = &_tl.events[i];
+    // a slot reserved by a thread that did not fill it in yet
+    if (!e->name) continue;
+    if (e->ph == 'M') {
+      fprintf(f, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\","
+        "\"args\":{\"name\":\"%s\"}}", e->tid, e->name);
+      continue;
+    }
+    fprintf(f, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"cat\":\"%s\",\"name\":\"%s\","
+      "\"ts\":%.3f", e->ph, e->tid, e->cat, e->name, e->ts / 1E3);
+    if (e->ph == 'X') fprintf(f, ",\"dur\":%.3f", e->dur / 1E3);
+    else fprintf(f, ",\"s\":\"t\"");
+    if (e->key) fprintf(f, ",\"args\":{\"%s\":%ld}", e->key, e->value);
+    fputc('}', f);
+  }
+  fprintf(f, "\n]}\n");
+  if (fclose(f)) {
+    perror("Could not write timeline file");
+    rv = 1;
+  }
+  eprintf("Timeline: %zu events written to %s", n, path);
+  if (atomic_load(&_tl.dropped) > 0) {
+    eprintf(", %" PRIu64 " dropped (buffer full)", (uint64_t)atomic_load(&_tl.dropped));
+  }
+  eprintf("\n");
+free_events:
+  free(_tl.events);
+  _tl.events = NULL;
+  return rv;
+}
+
+
+// RECORDING ===================================================================
+
+int timeline_enabled(void) {
+  return atomic_load_explicit(&_tl.on, memory_order_relaxed);
+}
+
+void timeline_span(const char *cat, const char *name, uint64_t t0, uint64_t t1, const char *key, int64_t value) {
+  event_t *e;
+  if (!timeline_enabled() || !(e = reserve())) return;
+  *e = (event_t){
+    .ts = t0 - _tl.start, .dur = t1 > t0 ? t1 - t0 : 0,
+    .cat = cat, .name = name, .key = key, .value = value,
+    .tid = thread_id(), .ph = 'X'
+  };
+}
+
+void timeline_instant(const char *cat, const char *name, const char *key, int64_t value) {
+  event_t *e;
+  if (!timeline_enabled() || !(e = reserve())) return;
+  *e = (event_t){
+    .ts = now_ns() - _tl.start,
+    .cat = cat, .name = name, .key = key, .value = value,
+    .tid = thread_id(), .ph = 'i'
+  };
+}
+
+void timeline_thread_name(const char *name) {
+  event_t *e;
+  if (!timeline_enabled() || !(e = reserve())) return;
+  *e = (event_t){.name = name, .tid = thread_id(), .ph = 'M'};
+}
+
+
+// GETTERS =====================================================================
+
+uint64_t timeline_dropped(void) {
+  return atomic_load(&_tl.dropped);
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__\___|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+static event_t *reserve(void) {
+  size_t i = atomic_fetch_add_explicit(&_tl.next, 1, memory_order_relaxed);
+  if (i >= _tl.capacity) {
+    atomic_fetch_add_explicit(&_tl.dropped, 1, memory_order_relaxed);
+    return NULL;
+  }
+  return &_tl.events[i];
+}
+
+// the kernel thread id, cached: it is what profilers show as well
+static uint32_t thread_id(void) {
+  if (_tid == 0) {
+#ifdef __linux__
+    _tid = (uint32_t)syscall(SYS_gettid);
+#else
+    static atomic_uint count = 0;
+    _tid = atomic_fetch_add(&count, 1) + 1;
+#endif
+  }
+  return _tid;
+}
@@ -0,0 +1,59 @@
+//   _____ _                _ _
+//  |_   _(_)_ __ ___   ___| (_)_ __   ___
+//    | | | | '_ ` _ \ / _ \ | | '_ \ / _ \
+//    | | | | | | | | |  __/ | | | | |  __/
+//    |_| |_|_| |_| |_|\___|_|_|_| |_|\___|
+//  Timeline tracing
+//  Process-wide, optional event buffer for latency debugging: FSM steps and
+//  transitions, setpoints sent, feedback received and tick sleeps, from any
+//  thread, exported as Chrome trace JSON (open it in chrome://tracing or
+//  https://ui.perfetto.dev).
+//  Recording is lock-free: each event reserves a slot of a preallocated
+//  buffer with an atomic increment; when the buffer is full, events are
+//  dropped and counted. When the timeline is not started, every call
+//  returns after a single load.
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "defines.h"
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Allocate room for capacity events and start recording. Returns 0 on
+// success
+int timeline_start(size_t capacity);
+
+// Stop recording and write the events to path as Chrome trace JSON, then
+// free the buffer. Call it once the other threads stopped recording.
+// Returns 0 on success
+int timeline_write(const char *path);
+
+// RECORDING ===================================================================
+
+// All strings must be static (only the pointers are stored); key may be
+// NULL, if there is no argument
+
+int timeline_enabled(void);
+
+// An event from t0 to t1 (ns, see now_ns())
+void timeline_span(const char *cat, const char *name, uint64_t t0, uint64_t t1, const char *key, int64_t value);
+
+// An instantaneous event, now
+void timeline_instant(const char *cat, const char *name, const char *key, int64_t value);
+
+// Name the calling thread in the timeline
+void timeline_thread_name(const char *name);
+
+// GETTERS =====================================================================
+
+uint64_t timeline_dropped(void);
+
+#endif // TIMELINE_H
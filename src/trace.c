@@ -0,0 +1,475 @@
+//   _____
+//  |_   _| __ __ _  ___ ___
+//    | || '__/ _` |/ __/ _ \
+//    | || | | (_| | (_|  __/
+//    |_||_|  \__,_|\___\___|
+//
+
+#include "trace.h"
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define FILE_MAGIC "CCNCTRC1"
+#define CHUNK_MAGIC 0x4b4e4843 // "CHNK"
+#define INDEX_MAGIC 0x58444954 // "TIDX"
+#define NAME_LEN 16
+#define MAX_VARINT 10          // bytes of a 64 bit varint
+
+const char *trace_column_names[TRACE_COLUMNS] = {
+  "n", "t_tot", "t_blk", "lambda", "s", "feed", "x", "y", "z"
+};
+
+// fixed-point scale and delta order of each column, as written in the
+// header: times in ns, the rest with the 6 decimals of the CSV
+static const struct {
+  data_t scale;
+  uint32_t order;
+} column_spec[TRACE_COLUMNS] = {
+  {1, 1}, {1E9, 2}, {1E9, 2}, {1E6, 2}, {1E6, 2}, {1E6, 2}, {1E6, 2}, {1E6, 2}, {1E6, 2}
+};
+
+typedef struct {
+  uint64_t offset;           // of the chunk header in the file
+  uint64_t first;            // first row
+  uint32_t rows;
+  uint32_t pad;
+} index_entry_t;
+
+// Trace writer object structure
+typedef struct trace {
+  FILE *f;
+  unsigned columns;          // mask of the stored columns
+  size_t chunk_rows, count;  // rows per chunk, rows in the current chunk
+  uint64_t rows;             // rows written so far
+  int64_t *col[TRACE_COLUMNS];
+  uint8_t *enc;              // encoding scratch, one column at a time
+  index_entry_t *index;
+  size_t n_chunks, index_len;
+} trace_t;
+
+// Trace reader object structure
+typedef struct trace_reader {
+  FILE *f;
+  unsigned columns;
+  data_t scale[TRACE_COLUMNS];
+  uint32_t order[TRACE_COLUMNS];
+  index_entry_t *index;
+  size_t n_chunks;
+  uint64_t rows;
+  uint8_t *buf;              // compressed chunk
+  size_t buf_len;
+} trace_reader_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int write_chunk(trace_t *t);
+static size_t encode(const int64_t *v, size_t n, uint32_t order, uint8_t *out);
+static int decode(const uint8_t *in, size_t len, size_t n, uint32_t order, data_t scale, data_t *out);
+static int read_index(trace_reader_t *r, long data_start);
+static int scan_chunks(trace_reader_t *r, long data_start);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// WRITING =====================================================================
+
+trace_t *trace_open(const char *path, size_t chunk_rows, unsigned columns) {
+  assert(path);
+  uint32_t u;
+  char name[NAME_LEN];
+  size_t i;
+  trace_t *t = (trace_t *)calloc(1, sizeof(trace_t));
+  if (!t) {
+    perror("Could not allocate trace");
+    return NULL;
+  }
+  t->chunk_rows = chunk_rows > 0 ? chunk_rows : TRACE_CHUNK_ROWS;
+  t->columns = columns & TRACE_ALL_COLUMNS;
+  for (i = 0; i < TRACE_COLUMNS; i++) {
+    t->col[i] = (int64_t *)calloc(t->chunk_rows, sizeof(int64_t));
+  }
+  t->enc = (uint8_t *)malloc(t->chunk_rows * MAX_VARINT);
+  t->f = fopen(path, "wb");
+  if (!t->f || !t->enc) {
+    perror("Could not create trace");
+    trace_close(t);
+    return NULL;
+  }
+  // header
+  fwrite(FILE_MAGIC, 1, 8, t->f);
+  u = TRACE_COLUMNS;
+  fwrite(&u, sizeof(u), 1, t->f);
+  u = t->chunk_rows;
+  fwrite(&u, sizeof(u), 1, t->f);
+  for (i = 0; i < TRACE_COLUMNS; i++) {
+    memset(name, 0, NAME_LEN);
+    strncpy(name, trace_column_names[i], NAME_LEN - 1);
+    fwrite(name, 1, NAME_LEN, t->f);
+    fwrite(&column_spec[i].scale, sizeof(data_t), 1, t->f);
+    fwrite(&column_spec[i].order, sizeof(uint32_t), 1, t->f);
+    u = (t->columns & (1u << i)) ? 0 : 1;
+    fwrite(&u, sizeof(u), 1, t->f);
+  }
+  return t;
+}
+
+int trace_append(trace_t *t, const data_t *row) {
+  assert(t && row);
+  size_t i;
+  for (i = 0; i < TRACE_COLUMNS; i++) {
+    if (!t->col[i]) return 1;
+    if (!(t->columns & (1u << i))) continue;
+    t->col[i][t->count] = llround(row[i] * column_spec[i].scale);
+  }
+  t->count++;
+  t->rows++;
+  if (t->count == t->chunk_rows) return write_chunk(t);
+  return 0;
+}
+
+int trace_close(trace_t *t) {
+  assert(t);
+  int rv = 0;
+  size_t i;
+  uint64_t index_offset;
+  uint32_t u;
+  if (t->f) {
+    if (t->count > 0) rv += write_chunk(t);
+    index_offset = ftell(t->f);
+    fwrite(t->index, sizeof(index_entry_t), t->n_chunks, t->f);
+    fwrite(&index_offset, sizeof(index_offset), 1, t->f);
+    fwrite(&t->rows, sizeof(t->rows), 1, t->f);
+    u = t->n_chunks;
+    fwrite(&u, sizeof(u), 1, t->f);
+    u = INDEX_MAGIC;
+    fwrite(&u, sizeof(u), 1, t->f);
+    if (fclose(t->f)) {
+      perror("Could not close trace");
+      rv++;
+    }
+  }
+  for (i = 0; i < TRACE_COLUMNS; i++) {
+    free(t->col[i]);
+  }
+  free(t->enc);
+  free(t->index);
+  free(t);
+  t = NULL;
+  return rv;
+}
+
+uint64_t trace_rows(const trace_t *t) {
+  assert(t);
+  return t->rows;
+}
+
+
+// READING =====================================================================
+
+trace_reader_t *trace_reader_open(const char *path) {
+  assert(path);
+  char magic[8], name[NAME_LEN];
+  uint32_t n_cols, chunk_rows, omitted;
+  size_t i;
+  trace_reader_t *r = (trace_reader_t *)calloc(1, sizeof(trace_reader_t));
+  if (!r) {
+    perror("Could not allocate trace reader");
+    return NULL;
+  }
+  r->f = fopen(path, "rb");
+  if (!r->f) {
+    perror("Could not open trace");
+    free(r);
+    return NULL;
+  }
+  if (fread(magic, 1, 8, r->f) != 8 || memcmp(magic, FILE_MAGIC, 8) ||
+      fread(&n_cols, sizeof(n_cols), 1, r->f) != 1 || n_cols != TRACE_COLUMNS ||
+      fread(&chunk_rows, sizeof(chunk_rows), 1, r->f) != 1) {
+    eprintf("%s is not a C-CNC trace\n", path);
+    trace_reader_close(r);
+    return NULL;
+  }
+  for (i = 0; i < TRACE_COLUMNS; i++) {
+    if (fread(name, 1, NAME_LEN, r->f) != NAME_LEN ||
+        fread(&r->scale[i], sizeof(data_t), 1, r->f) != 1 ||
+        fread(&r->order[i], sizeof(uint32_t), 1, r->f) != 1 ||
+        fread(&omitted, sizeof(omitted), 1, r->f) != 1) {
+      eprintf("Truncated trace header in %s\n", path);
+      trace_reader_close(r);
+      return NULL;
+    }
+    if (!omitted) r->columns |= 1u << i;
+  }
+  // no index (the writer did not close the file): rebuild it
+  if (read_index(r, ftell(r->f)) && scan_chunks(r, ftell(r->f))) {
+    eprintf("Corrupted trace %s\n", path);
+    trace_reader_close(r);
+    return NULL;
+  }
+  return r;
+}
+
+void trace_reader_close(trace_reader_t *r) {
+  assert(r);
+  if (r->f) fclose(r->f);
+  free(r->index);
+  free(r->buf);
+  free(r);
+  r = NULL;
+}
+
+size_t trace_reader_chunks(const trace_reader_t *r) {
+  assert(r);
+  return r->n_chunks;
+}
+
+unsigned trace_reader_columns(const trace_reader_t *r) {
+  assert(r);
+  return r->columns;
+}
+
+uint64_t trace_reader_rows(const trace_reader_t *r) {
+  assert(r);
+  return r->rows;
+}
+
+size_t trace_reader_chunk_rows(const trace_reader_t *r, size_t i) {
+  assert(r && i < r->n_chunks);
+  return r->index[i].rows;
+}
+
+int trace_reader_chunk(trace_reader_t *r, size_t i, data_t **cols) {
+  assert(r && cols && i < r->n_chunks);
+  uint32_t head[2], bytes[TRACE_COLUMNS];
+  size_t c, k, total = 0, off = 0;
+  if (fseek(r->f, r->index[i].offset, SEEK_SET) ||
+      fread(head, sizeof(uint32_t), 2, r->f) != 2 || head[0] != CHUNK_MAGIC ||
+      fread(bytes, sizeof(uint32_t), TRACE_COLUMNS, r->f) != TRACE_COLUMNS) {
+    eprintf("Bad trace chunk %zu\n", i);
+    return 1;
+  }
+  for (c = 0; c < TRACE_COLUMNS; c++) total += bytes[c];
+  if (total > r->buf_len) {
+    free(r->buf);
+    r->buf = (uint8_t *)malloc(total);
+    r->buf_len = r->buf ? total : 0;
+    if (!r->buf) {
+      perror("Could not allocate trace chunk");
+      return 1;
+    }
+  }
+  if (fread(r->buf, 1, total, r->f) != total) {
+    eprintf("Truncated trace chunk %zu\n", i);
+    return 1;
+  }
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    if (!(r->columns & (1u << c))) {
+      for (k = 0; k < head[1]; k++) cols[c][k] = NAN;
+      continue;
+    }
+    if (decode(r->buf + off, bytes[c], head[1], r->order[c], r->scale[c], cols[c])) {
+      eprintf("Bad column %s in trace chunk %zu\n", trace_column_names[c], i);
+      return 1;
+    }
+    off += bytes[c];
+  }
+  return 0;
+}
+
+
+
+// CSV =========================================================================
+
+void trace_csv_header(FILE *out, unsigned columns) {
+  assert(out);
+  size_t c;
+  const char *sep = "";
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    if (!(columns & (1u << c))) continue;
+    fprintf(out, "%s%s", sep, trace_column_names[c]);
+    sep = ",";
+  }
+  fputc('\n', out);
+}
+
+void trace_csv_row(FILE *out, unsigned columns, const data_t *row) {
+  assert(out && row);
+  size_t c;
+  const char *sep = "";
+  // the common case, in one call
+  if ((columns & TRACE_ALL_COLUMNS) == TRACE_ALL_COLUMNS) {
+    fprintf(out, "%zu,%f,%f,%f,%f,%f,%f,%f,%f\n", (size_t)row[0], row[1],
+      row[2], row[3], row[4], row[5], row[6], row[7], row[8]);
+    return;
+  }
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    if (!(columns & (1u << c))) continue;
+    // the block number is an integer
+    if (c == 0) fprintf(out, "%s%zu", sep, (size_t)row[c]);
+    else fprintf(out, "%s%f", sep, row[c]);
+    sep = ",";
+  }
+  fputc('\n', out);
+}
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__\___|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Encode and write the buffered rows as a chunk, and index it
+static int write_chunk(trace_t *t) {
+  uint32_t head[2] = {CHUNK_MAGIC, t->count}, bytes[TRACE_COLUMNS] = {0};
+  long start = ftell(t->f);
+  size_t c;
+  index_entry_t *idx;
+  if (t->n_chunks == t->index_len) {
+    t->index_len = t->index_len ? 2 * t->index_len : 64;
+    idx = (index_entry_t *)realloc(t->index, t->index_len * sizeof(index_entry_t));
+    if (!idx) {
+      perror("Could not grow trace index");
+      return 1;
+    }
+    t->index = idx;
+  }
+  t->index[t->n_chunks++] = (index_entry_t){
+    .offset = start, .first = t->rows - t->count, .rows = t->count
+  };
+  // sizes are only known after encoding: write the header, then patch it
+  fwrite(head, sizeof(uint32_t), 2, t->f);
+  fwrite(bytes, sizeof(uint32_t), TRACE_COLUMNS, t->f);
+  for (c = 0; c < TRACE_COLUMNS; c++) {
+    if (!(t->columns & (1u << c))) continue;
+    bytes[c] = encode(t->col[c], t->count, column_spec[c].order, t->enc);
+    fwrite(t->enc, 1, bytes[c], t->f);
+  }
+  fseek(t->f, start + 2 * sizeof(uint32_t), SEEK_SET);
+  fwrite(bytes, sizeof(uint32_t), TRACE_COLUMNS, t->f);
+  fseek(t->f, 0, SEEK_END);
+  t->count = 0;
+  return ferror(t->f) ? 1 : 0;
+}
+
+// Delta encode order times (starting from 0, so each chunk is
+// self-contained), zig-zag and varint pack. Returns the encoded length
+static size_t encode(const int64_t *v, size_t n, uint32_t order, uint8_t *out) {
+  size_t i, len = 0;
+  int64_t prev = 0, prev_d = 0, d, e;
+  uint64_t z;
+  for (i = 0; i < n; i++) {
+    d = v[i] - prev;
+    prev = v[i];
+    if (order > 1) {
+      e = d - prev_d;
+      prev_d = d;
+    }
+    else {
+      e = order > 0 ? d : v[i];
+    }
+    z = ((uint64_t)e << 1) ^ (uint64_t)(e >> 63);
+    while (z >= 0x80) {
+      out[len++] = (uint8_t)(z | 0x80);
+      z >>= 7;
+    }
+    out[len++] = (uint8_t)z;
+  }
+  return len;
+}
+
+// Inverse of encode(), also scaling back to floating point. Returns 0 if
+// exactly n values were found in len bytes
+static int decode(const uint8_t *in, size_t len, size_t n, uint32_t order, data_t scale, data_t *out) {
+  size_t i, pos = 0;
+  int shift;
+  int64_t v = 0, d = 0, e;
+  uint64_t z;
+  for (i = 0; i < n; i++) {
+    z = 0;
+    shift = 0;
+    do {
+      if (pos >= len || shift > 63) return 1;
+      z |= (uint64_t)(in[pos] & 0x7f) << shift;
+      shift += 7;
+    } while (in[pos++] & 0x80);
+    e = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+    if (order > 1) {
+      d += e;
+      v += d;
+    }
+    else if (order > 0) {
+      v += e;
+    }
+    else {
+      v = e;
+    }
+    out[i] = v / scale;
+  }
+  return pos == len ? 0 : 1;
+}
+
+// Load the index from the footer. Returns 0 on success
+static int read_index(trace_reader_t *r, long data_start) {
+  uint64_t index_offset, rows;
+  uint32_t n_chunks, magic;
+  if (fseek(r->f, -24, SEEK_END) ||
+      fread(&index_offset, sizeof(index_offset), 1, r->f) != 1 ||
+      fread(&rows, sizeof(rows), 1, r->f) != 1 ||
+      fread(&n_chunks, sizeof(n_chunks), 1, r->f) != 1 ||
+      fread(&magic, sizeof(magic), 1, r->f) != 1 || magic != INDEX_MAGIC ||
+      index_offset < (uint64_t)data_start) {
+    fseek(r->f, data_start, SEEK_SET);
+    return 1;
+  }
+  r->index = (index_entry_t *)calloc(n_chunks + 1, sizeof(index_entry_t));
+  if (!r->index || fseek(r->f, index_offset, SEEK_SET) ||
+      fread(r->index, sizeof(index_entry_t), n_chunks, r->f) != n_chunks) {
+    free(r->index);
+    r->index = NULL;
+    fseek(r->f, data_start, SEEK_SET);
+    return 1;
+  }
+  r->n_chunks = n_chunks;
+  r->rows = rows;
+  return 0;
+}
+
+// Walk the chunks from data_start, skipping a truncated last one.
+// Returns 0 on success
+static int scan_chunks(trace_reader_t *r, long data_start) {
+  uint32_t head[2], bytes[TRACE_COLUMNS];
+  size_t c, len = 0, total;
+  long pos = data_start, end;
+  index_entry_t *idx;
+  fseek(r->f, 0, SEEK_END);
+  end = ftell(r->f);
+  fseek(r->f, data_start, SEEK_SET);
+  r->n_chunks = 0;
+  r->rows = 0;
+  while (fread(head, sizeof(uint32_t), 2, r->f) == 2 && head[0] == CHUNK_MAGIC &&
+         fread(bytes, sizeof(uint32_t), TRACE_COLUMNS, r->f) == TRACE_COLUMNS) {
+    for (total = 0, c = 0; c < TRACE_COLUMNS; c++) total += bytes[c];
+    if (pos + (long)sizeof(head) + (long)sizeof(bytes) + (long)total > end) break;
+    if (r->n_chunks == len) {
+      len = len ? 2 * len : 64;
+      idx = (index_entry_t *)realloc(r->index, len * sizeof(index_entry_t));
+      if (!idx) return 1;
+      r->index = idx;
+    }
+    r->index[r->n_chunks++] = (index_entry_t){
+      .offset = pos, .first = r->rows, .rows = head[1]
+    };
+    r->rows += head[1];
+    pos += sizeof(head) + sizeof(bytes) + total;
+    fseek(r->f, pos, SEEK_SET);
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+//   _____
+//  |_   _| __ __ _  ___ ___
+//    | || '__/ _` |/ __/ _ \
+//    | || | | (_| | (_|  __/
+//    |_||_|  \__,_|\___\___|
+//
+//  Trace class
+//  Columnar, chunked binary trajectory trace: the same columns as the CSV
+//  output (n,t_tot,t_blk,lambda,s,feed,x,y,z), at the same resolution
+//  (1 ns for times, 1e-6 for everything else), at a fraction of the size.
+//  Rows are buffered into chunks; within a chunk each column is stored as
+//  fixed-point integers, delta encoded (twice for smooth signals, so that
+//  timestamps and setpoints cost about one byte per row) and packed as
+//  zig-zag varints. An index of chunks is appended on close; files left
+//  without it (e.g. after a crash) are still read, by scanning.
+//
+//  File layout (little endian):
+//    header  "CCNCTRC1", u32 columns, u32 chunk rows,
+//            per column: char name[16], f64 scale, u32 delta order,
+//            u32 omitted (1: not stored)
+//    chunks  u32 "CHNK", u32 rows, u32 bytes[columns], column payloads
+//            (0 bytes for omitted columns)
+//    index   per chunk: u64 file offset, u64 first row, u32 rows, u32 0
+//    footer  u64 index offset, u64 rows, u32 chunks, u32 "TIDX"
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque structs
+typedef struct trace trace_t;
+typedef struct trace_reader trace_reader_t;
+
+#define TRACE_COLUMNS 9
+#define TRACE_CHUNK_ROWS 4096
+// column bit masks: bit i is column i of trace_column_names
+#define TRACE_ALL_COLUMNS ((1u << TRACE_COLUMNS) - 1)
+
+// column names, in order
+extern const char *trace_column_names[TRACE_COLUMNS];
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// WRITING =====================================================================
+
+// Create (truncate) a trace file storing the columns in the mask;
+// chunk_rows 0 means TRACE_CHUNK_ROWS. Returns NULL on failure
+trace_t *trace_open(const char *path, size_t chunk_rows, unsigned columns);
+
+// Append a row of TRACE_COLUMNS values (omitted columns are ignored). Only
+// every chunk_rows rows this encodes and writes a chunk. Returns 0 on
+// success
+int trace_append(trace_t *t, const data_t *row);
+
+// Write the last chunk and the index, and close the file. Returns 0 on
+// success
+int trace_close(trace_t *t);
+
+uint64_t trace_rows(const trace_t *t);
+
+// READING =====================================================================
+
+// Open a trace file for reading. Returns NULL on failure
+trace_reader_t *trace_reader_open(const char *path);
+void trace_reader_close(trace_reader_t *r);
+
+size_t trace_reader_chunks(const trace_reader_t *r);
+// mask of the columns stored in the file
+unsigned trace_reader_columns(const trace_reader_t *r);
+uint64_t trace_reader_rows(const trace_reader_t *r);
+
+// rows in chunk i
+size_t trace_reader_chunk_rows(const trace_reader_t *r, size_t i);
+
+// Decode chunk i into cols: TRACE_COLUMNS arrays of at least
+// trace_reader_chunk_rows() values (omitted columns are filled with NaN).
+// Returns 0 on success
+int trace_reader_chunk(trace_reader_t *r, size_t i, data_t **cols);
+
+// CSV =========================================================================
+
+// The CSV format of c-cnc, restricted to the columns in the mask
+void trace_csv_header(FILE *out, unsigned columns);
+void trace_csv_row(FILE *out, unsigned columns, const data_t *row);
+
+#endif // TRACE_H
@@ -0,0 +1,225 @@
+//   _____                      __ _ _ _
+//  |_   _| __ __ _  ___ ___   / _(_) | |_ ___ _ __
+//    | || '__/ _` |/ __/ _ \ | |_| | | __/ _ \ '__|
+//    | || | | (_| | (_|  __/ |  _| | | ||  __/ |
+//    |_||_|  \__,_|\___\___| |_| |_|_|\__\___|_|
+//
+
+#include "trace_filter.h"
+#include "trace.h"
+#include "inic.h"
+#include <inttypes.h>
+
+//   ____            _                 _   _
+//  |  _ \  ___  ___| | __ _ _ __ __ _| |_(_) ___  _ __  ___
+//  | | | |/ _ \/ __| |/ _` | '__/ _` | __| |/ _ \| '_ \/ __|
+//  | |_| |  __/ (__| | (_| | | | (_| | |_| | (_) | | | \__ \
+//  |____/ \___|\___|_|\__,_|_|  \__,_|\__|_|\___/|_| |_|___/
+
+#define BUFLEN 1024
+#define MAX_RANGES 64
+
+typedef struct {
+  size_t first, last;        // block numbers, inclusive
+} range_t;
+
+// Trace filter object structure
+typedef struct trace_filter {
+  int decimation;            // log one sample every decimation
+  unsigned columns;          // mask, see trace.h
+  range_t ranges[MAX_RANGES];
+  size_t n_ranges;           // 0: all blocks
+  data_t error_trigger;      // mm, 0 to disable
+  int trigger_hold;          // ticks of full-rate logging after a trigger
+  int hold;                  // ticks left in the current capture
+  uint64_t seen, logged, triggers;
+} trace_filter_t;
+
+// STATIC FUNCTIONS (for internal use only) ====================================
+static int parse_columns(trace_filter_t *f, char *list);
+static int parse_ranges(trace_filter_t *f, char *list);
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+trace_filter_t *trace_filter_new(const char *ini_path) {
+  assert(ini_path);
+  char buf[BUFLEN];
+  void *ini;
+  trace_filter_t *f = (trace_filter_t *)calloc(1, sizeof(trace_filter_t));
+  if (!f) {
+    perror("Could not allocate trace filter");
+    return NULL;
+  }
+  ini = ini_init(ini_path);
+  if (!ini) {
+    eprintf("Could not open the ini file %s\n", ini_path);
+    free(f);
+    return NULL;
+  }
+  // all optional
+  if (ini_get_int(ini, "TRACE", "decimation", &f->decimation))
+    f->decimation = 1;
+  if (ini_get_double(ini, "TRACE", "error_trigger", &f->error_trigger))
+    f->error_trigger = 0;
+  if (ini_get_int(ini, "TRACE", "trigger_hold", &f->trigger_hold))
+    f->trigger_hold = 200;
+  f->columns = TRACE_ALL_COLUMNS;
+  if (!ini_get_char(ini, "TRACE", "columns", buf, BUFLEN) && parse_columns(f, buf)) {
+    ini_free(ini);
+    free(f);
+    return NULL;
+  }
+  if (!ini_get_char(ini, "TRACE", "blocks", buf, BUFLEN) && parse_ranges(f, buf)) {
+    ini_free(ini);
+    free(f);
+    return NULL;
+  }
+  ini_free(ini);
+  f->decimation = MAX(1, f->decimation);
+  f->trigger_hold = MAX(0, f->trigger_hold);
+  return f;
+}
+
+void trace_filter_free(trace_filter_t *f) {
+  assert(f);
+  free(f);
+  f = NULL;
+}
+
+
+// FILTERING ===================================================================
+
+int trace_filter_pass(trace_filter_t *f, size_t n, data_t error) {
+  assert(f);
+  size_t i;
+  int pass = 0;
+  // the decimation phase does not depend on what was logged, so that
+  // decimated samples stay evenly spaced across captures
+  uint64_t tick = f->seen++;
+  if (f->error_trigger > 0 && error > f->error_trigger) {
+    if (f->hold == 0) f->triggers++;
+    f->hold = f->trigger_hold + 1;
+  }
+  if (f->hold > 0) {
+    f->hold--;
+    pass = 1;
+  }
+  else if (tick % f->decimation == 0) {
+    pass = (f->n_ranges == 0);
+    for (i = 0; i < f->n_ranges && !pass; i++) {
+      pass = (n >= f->ranges[i].first && n <= f->ranges[i].last);
+    }
+  }
+  if (pass) f->logged++;
+  return pass;
+}
+
+void trace_filter_print(const trace_filter_t *f, FILE *out) {
+  assert(f && out);
+  size_t i;
+  fprintf(out, "Trace filter: 1 sample every %d, blocks %s", f->decimation,
+    f->n_ranges ? "" : "all");
+  for (i = 0; i < f->n_ranges; i++) {
+    if (f->ranges[i].last == SIZE_MAX)
+      fprintf(out, "%s%zu-", i ? "," : "", f->ranges[i].first);
+    else if (f->ranges[i].last == f->ranges[i].first)
+      fprintf(out, "%s%zu", i ? "," : "", f->ranges[i].first);
+    else
+      fprintf(out, "%s%zu-%zu", i ? "," : "", f->ranges[i].first, f->ranges[i].last);
+  }
+  if (f->error_trigger > 0) {
+    fprintf(out, ", full rate for %d ticks when error > %g (%" PRIu64 " triggers)",
+      f->trigger_hold, f->error_trigger, f->triggers);
+  }
+  fprintf(out, "\nTrace filter: %" PRIu64 " of %" PRIu64 " samples logged\n", f->logged, f->seen);
+}
+
+
+// GETTERS =====================================================================
+
+unsigned trace_filter_columns(const trace_filter_t *f) {
+  assert(f);
+  return f->columns;
+}
+
+uint64_t trace_filter_seen(const trace_filter_t *f) {
+  assert(f);
+  return f->seen;
+}
+
+uint64_t trace_filter_logged(const trace_filter_t *f) {
+  assert(f);
+  return f->logged;
+}
+
+uint64_t trace_filter_triggers(const trace_filter_t *f) {
+  assert(f);
+  return f->triggers;
+}
+
+
+
+//   ____  _        _   _         __
+//  / ___|| |_ __ _| |_(_) ___   / _|_   _ _ __   ___
+//  \___ \| __/ _` | __| |/ __| | |_| | | | '_ \ / __|
+//   ___) | || (_| | |_| | (__  |  _| |_| | | | | (__
+//  |____/ \__\__,_|\__|_|\___| |_|  \__,_|_| |_|\___|
+// Definitions for the static functions declared above
+
+// Comma separated column names, e.g. "n,t_tot,x,y,z"; empty means all
+static int parse_columns(trace_filter_t *f, char *list) {
+  char *tok, *save;
+  size_t c;
+  unsigned columns = 0;
+  for (tok = strtok_r(list, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+    for (c = 0; c < TRACE_COLUMNS; c++) {
+      if (strcmp(tok, trace_column_names[c]) == 0) break;
+    }
+    if (c == TRACE_COLUMNS) {
+      eprintf("Unknown trace column %s\n", tok);
+      return 1;
+    }
+    columns |= 1u << c;
+  }
+  if (columns) f->columns = columns;
+  return 0;
+}
+
+// Comma separated block numbers and ranges, e.g. "3,10-20,35-" (from 35
+// to the end); empty means all
+static int parse_ranges(trace_filter_t *f, char *list) {
+  char *tok, *save, *end, *last;
+  range_t r;
+  for (tok = strtok_r(list, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+    r.first = strtoul(tok, &end, 10);
+    if (end == tok) goto bad_range;
+    r.last = r.first;
+    if (*end == '-') {
+      last = end + 1;
+      r.last = SIZE_MAX;
+      if (*last) {
+        r.last = strtoul(last, &end, 10);
+        if (end == last) goto bad_range;
+      }
+      else {
+        end = last;
+      }
+    }
+    if (*end || r.last < r.first) goto bad_range;
+    if (f->n_ranges == MAX_RANGES) {
+      eprintf("Too many trace block ranges (max %d)\n", MAX_RANGES);
+      return 1;
+    }
+    f->ranges[f->n_ranges++] = r;
+  }
+  return 0;
+bad_range:
+  eprintf("Malformed trace block range %s\n", tok);
+  return 1;
+}
@@ -0,0 +1,62 @@
+//   _____                      __ _ _ _
+//  |_   _| __ __ _  ___ ___   / _(_) | |_ ___ _ __
+//    | || '__/ _` |/ __/ _ \ | |_| | | __/ _ \ '__|
+//    | || | | (_| | (_|  __/ |  _| | | ||  __/ |
+//    |_||_|  \__,_|\___\___| |_| |_|_|\__\___|_|
+//  Trace filter class
+//  Decides, on the realtime side, which trajectory samples get logged: one
+//  every `decimation` ticks, only within the configured ranges of block
+//  numbers (the N words of the program, as in the n column), and
+//  only the selected columns. When the positioning error exceeds a
+//  threshold, every sample is logged (full rate, any block) until the
+//  error has stayed below it for `trigger_hold` ticks.
+//  Configured in the [TRACE] section of the INI file; with no such section
+//  everything is logged.
+
+#ifndef TRACE_FILTER_H
+#define TRACE_FILTER_H
+
+#include "defines.h"
+
+//   _____
+//  |_   _|   _ _ __   ___  ___
+//    | || | | | '_ \ / _ \/ __|
+//    | || |_| | |_) |  __/\__ \
+//    |_| \__, | .__/ \___||___/
+//        |___/|_|
+
+// Opaque struct
+typedef struct trace_filter trace_filter_t;
+
+
+//   _____                 _   _
+//  |  ___|   _ _ __   ___| |_(_) ___  _ __  ___
+//  | |_ | | | | '_ \ / __| __| |/ _ \| '_ \/ __|
+//  |  _|| |_| | | | | (__| |_| | (_) | | | \__ \
+//  |_|   |_|\__,_|_| |_|\___|\__|_|\___/|_| |_|___/
+
+// LIFECYCLE ===================================================================
+
+// Read the [TRACE] section of the INI file. Returns NULL on failure (e.g.
+// unknown column names or malformed block ranges)
+trace_filter_t *trace_filter_new(const char *ini_path);
+void trace_filter_free(trace_filter_t *f);
+
+// FILTERING ===================================================================
+
+// Call once per sample: returns 1 if the sample for block number n, with
+// the given positioning error, is to be logged
+int trace_filter_pass(trace_filter_t *f, size_t n, data_t error);
+
+// Print the filter settings and how many samples passed
+void trace_filter_print(const trace_filter_t *f, FILE *out);
+
+// GETTERS =====================================================================
+
+// logged columns (mask, see trace.h)
+unsigned trace_filter_columns(const trace_filter_t *f);
+uint64_t trace_filter_seen(const trace_filter_t *f);
+uint64_t trace_filter_logged(const trace_filter_t *f);
+uint64_t trace_filter_triggers(const trace_filter_t *f);
+
+#endif // TRACE_FILTER_H
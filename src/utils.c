@@ -14,8 +14,12 @@
 #endif
 
 #include <unistd.h> // Sleep
+#include <errno.h>
 
-static uint64_t now_ns() {
+// default spin time of wait_next() (ns)
+#define WAIT_SPIN 100000
+
+uint64_t now_ns() {
   static uint64_t is_init = 0;
 #if defined(__APPLE__)
   static mach_timebase_info_data_t info;
@@ -43,16 +47,35 @@ static uint64_t now_ns() {
 }
 
 
+// Sleep until deadline (ns, see now_ns()), then busy-wait for the final
+// spin nanoseconds: the scheduler wakeup latency is absorbed by the spin,
+// which is the only part burning CPU. Returns the lateness (ns)
+uint64_t sleep_until(uint64_t deadline, uint64_t spin) {
+  uint64_t now = now_ns();
+  if (deadline > spin && now < deadline - spin) {
+#if defined(HAVE_POSIX_TIMER)
+    struct timespec ts = {
+      .tv_sec = (deadline - spin) / 1000000000ULL,
+      .tv_nsec = (deadline - spin) % 1000000000ULL
+    };
+    // restart after signals: the deadline is absolute
+    while (clock_nanosleep(CLOCKID, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+    usleep((deadline - spin - now) / 1000);
+#endif
+  }
+  while ((now = now_ns()) < deadline);
+  return now - deadline;
+}
+
 uint64_t wait_next(uint64_t interval) {
   static uint64_t last_call = 0;
-  uint64_t delta, delay;
+  uint64_t delay;
   if (last_call == 0 || interval == 0) last_call = now_ns();
-  while ((delta = now_ns() - last_call)) {
-    if (delta >= interval) {
-      delay = delta - interval;
-      last_call = now_ns() - delay;
-      return delay;
-    }
-  }
-  return 0;
-}
\ No newline at end of file
+  delay = sleep_until(last_call + interval, WAIT_SPIN);
+  // after a stall of a period or more, the missed periods are dropped and
+  // the next call waits a full interval, rather than returning at once
+  // until the schedule catches up
+  last_call = delay < interval ? last_call + interval : now_ns();
+  return delay;
+}